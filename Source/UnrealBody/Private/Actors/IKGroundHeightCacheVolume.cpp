@@ -0,0 +1,81 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Actors/IKGroundHeightCacheVolume.h"
+#include "Subsystems/IKBodySubsystem.h"
+#include "Engine/AssetManager.h"
+
+AIKGroundHeightCacheVolume::AIKGroundHeightCacheVolume()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	this->Bounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bounds"));
+	this->Bounds->SetBoxExtent(FVector(1000.0f, 1000.0f, 200.0f));
+	this->Bounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	this->Bounds->SetCanEverAffectNavigation(false);
+	RootComponent = this->Bounds;
+}
+
+void AIKGroundHeightCacheVolume::BakeGroundCache()
+{
+	UIKGroundHeightCache* Target = this->LoadedCache != nullptr ? this->LoadedCache : this->Cache.LoadSynchronous();
+	if (Target == nullptr)
+	{
+		UE_LOG(LogIKGroundHeightCache, Warning, TEXT("%s has no ground height cache asset to bake into."), *GetName());
+		return;
+	}
+
+	Target->Bake(GetWorld(), this->Bounds->Bounds.GetBox());
+	Target->MarkPackageDirty();
+}
+
+void AIKGroundHeightCacheVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (this->Cache.IsNull())
+	{
+		if (!this->bBakeOnLoad)
+			return;
+
+		this->LoadedCache = NewObject<UIKGroundHeightCache>(this);
+		this->LoadedCache->Bake(GetWorld(), this->Bounds->Bounds.GetBox());
+		GetWorld()->GetSubsystem<UIKBodySubsystem>()->SetGroundHeightCache(this->LoadedCache);
+		return;
+	}
+
+	// Stream the baked cache in without hitching the level load
+	UAssetManager::GetStreamableManager().RequestAsyncLoad(this->Cache.ToSoftObjectPath(), 
+		FStreamableDelegate::CreateUObject(this, &AIKGroundHeightCacheVolume::OnCacheLoaded));
+}
+
+void AIKGroundHeightCacheVolume::OnCacheLoaded()
+{
+	this->LoadedCache = this->Cache.Get();
+	if (this->LoadedCache == nullptr || GetWorld() == nullptr)
+		return;
+
+	if (!this->LoadedCache->IsBaked() && this->bBakeOnLoad)
+	{
+		this->LoadedCache->Bake(GetWorld(), this->Bounds->Bounds.GetBox());
+	}
+
+	GetWorld()->GetSubsystem<UIKBodySubsystem>()->SetGroundHeightCache(this->LoadedCache);
+}
+
+void AIKGroundHeightCacheVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UIKBodySubsystem* Subsystem = GetWorld() != nullptr ? GetWorld()->GetSubsystem<UIKBodySubsystem>() : nullptr;
+	if (Subsystem != nullptr && Subsystem->GetGroundHeightCache() == this->LoadedCache)
+	{
+		Subsystem->SetGroundHeightCache(nullptr);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
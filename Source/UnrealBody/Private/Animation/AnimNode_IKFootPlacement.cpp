@@ -0,0 +1,271 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Animation/AnimNode_IKFootPlacement.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "TwoBoneIK.h"
+
+// Sample order used by the batched ground query
+enum EFootSample
+{
+	LeftHeel,
+	LeftToe,
+	RightHeel,
+	RightToe,
+	Count
+};
+
+void FAnimNode_IKFootPlacement::Initialize_AnyThread(const FAnimationInitializeContext& Context)
+{
+	FAnimNode_SkeletalControlBase::Initialize_AnyThread(Context);
+
+	this->LeftLeg.Offset = this->RightLeg.Offset = 0.0f;
+	this->LeftLeg.Rotation = this->RightLeg.Rotation = FQuat::Identity;
+	this->LeftLeg.bLocked = this->RightLeg.bLocked = false;
+	this->LeftLeg.LockAlpha = this->RightLeg.LockAlpha = 0.0f;
+	this->PelvisOffset = 0.0f;
+	this->bFirstUpdate = true;
+}
+
+void FAnimNode_IKFootPlacement::GatherDebugData(FNodeDebugData& DebugData)
+{
+	FString DebugLine = DebugData.GetNodeName(this);
+	DebugLine += FString::Printf(TEXT("(Pelvis: %.1f, Left: %.1f%s, Right: %.1f%s)"), 
+		this->PelvisOffset,
+		this->LeftLeg.Offset, this->LeftLeg.bLocked ? TEXT(" locked") : TEXT(""),
+		this->RightLeg.Offset, this->RightLeg.bLocked ? TEXT(" locked") : TEXT(""));
+	DebugData.AddDebugItem(DebugLine);
+
+	ComponentPose.GatherDebugData(DebugData);
+}
+
+void FAnimNode_IKFootPlacement::UpdateInternal(const FAnimationUpdateContext& Context)
+{
+	FAnimNode_SkeletalControlBase::UpdateInternal(Context);
+	this->DeltaTime = Context.GetDeltaTime();
+}
+
+void FAnimNode_IKFootPlacement::InitializeBoneReferences(const FBoneContainer& RequiredBones)
+{
+	this->PelvisBone.Initialize(RequiredBones);
+
+	for (FIKFootPlacementLeg* Leg : { &this->LeftLeg, &this->RightLeg })
+	{
+		Leg->FootBone.Initialize(RequiredBones);
+		Leg->FootIndex = Leg->FootBone.GetCompactPoseIndex(RequiredBones);
+		Leg->CalfIndex = Leg->FootIndex.IsValid() ? RequiredBones.GetParentBoneIndex(Leg->FootIndex) : FCompactPoseBoneIndex(INDEX_NONE);
+		Leg->ThighIndex = Leg->CalfIndex.IsValid() ? RequiredBones.GetParentBoneIndex(Leg->CalfIndex) : FCompactPoseBoneIndex(INDEX_NONE);
+	}
+}
+
+bool FAnimNode_IKFootPlacement::IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones)
+{
+	return this->PelvisBone.IsValidToEvaluate(RequiredBones)
+		&& this->LeftLeg.ThighIndex.IsValid()
+		&& this->RightLeg.ThighIndex.IsValid();
+}
+
+void FAnimNode_IKFootPlacement::SampleGround(FComponentSpacePoseContext& Output, const FTransform& LeftFoot, const FTransform& RightFoot)
+{
+	this->LeftLeg.bGroundHit = this->RightLeg.bGroundHit = false;
+
+	const USkeletalMeshComponent* Mesh = Output.AnimInstanceProxy->GetSkelMeshComponent();
+	UWorld* World = Mesh != nullptr ? Mesh->GetWorld() : nullptr;
+	if (World == nullptr) return;
+
+	const FTransform& ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
+	const FVector Forward = this->FootForwardAxis.GetSafeNormal();
+
+	// Heel and toe positions in component space, on the root plane
+	FVector Samples[EFootSample::Count] = {
+		LeftFoot.GetLocation() - Forward * this->HeelLength,
+		LeftFoot.GetLocation() + Forward * this->ToeLength,
+		RightFoot.GetLocation() - Forward * this->HeelLength,
+		RightFoot.GetLocation() + Forward * this->ToeLength
+	};
+
+	FVector Starts[EFootSample::Count];
+	FVector Ends[EFootSample::Count];
+	FBox Bounds(ForceInit);
+	for (int32 i = 0; i < EFootSample::Count; ++i)
+	{
+		Samples[i].Z = 0.0f;
+		Starts[i] = ComponentTransform.TransformPosition(Samples[i] + FVector(0.0f, 0.0f, this->TraceHeight));
+		Ends[i] = ComponentTransform.TransformPosition(Samples[i] - FVector(0.0f, 0.0f, this->TraceDepth));
+		Bounds += Starts[i];
+		Bounds += Ends[i];
+	}
+
+	// One broadphase query for the whole avatar, the individual samples are then tested against the found primitives only
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(IKFootPlacement), false, Mesh->GetOwner());
+	TArray<FOverlapResult> Overlaps;
+	World->OverlapMultiByChannel(Overlaps, Bounds.GetCenter(), FQuat::Identity, this->TraceChannel,
+		FCollisionShape::MakeBox(Bounds.GetExtent()), Params);
+
+	bool Hits[EFootSample::Count] = { false, false, false, false };
+	FVector Normals[EFootSample::Count];
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		UPrimitiveComponent* Primitive = Overlap.GetComponent();
+		if (Primitive == nullptr || !Overlap.bBlockingHit) continue;
+
+		for (int32 i = 0; i < EFootSample::Count; ++i)
+		{
+			FHitResult Hit;
+			if (Primitive->LineTraceComponent(Hit, Starts[i], Ends[i], Params))
+			{
+				// Keep the highest ground under each sample
+				const float Height = ComponentTransform.InverseTransformPosition(Hit.ImpactPoint).Z;
+				if (!Hits[i] || Height > Samples[i].Z)
+				{
+					Hits[i] = true;
+					Samples[i].Z = Height;
+					Normals[i] = ComponentTransform.InverseTransformVectorNoScale(Hit.ImpactNormal);
+				}
+			}
+		}
+	}
+
+	// Resolve the ground height and orientation for both feet
+	const int32 HeelSamples[2] = { EFootSample::LeftHeel, EFootSample::RightHeel };
+	FIKFootPlacementLeg* Legs[2] = { &this->LeftLeg, &this->RightLeg };
+	for (int32 LegIndex = 0; LegIndex < 2; ++LegIndex)
+	{
+		FIKFootPlacementLeg& Leg = *Legs[LegIndex];
+		const int32 Heel = HeelSamples[LegIndex];
+		const int32 Toe = Heel + 1;
+
+		if (!Hits[Heel] && !Hits[Toe])
+		{
+			Leg.TargetOffset = 0.0f;
+			Leg.TargetRotation = FQuat::Identity;
+			continue;
+		}
+
+		FVector GroundUp;
+		if (Hits[Heel] && Hits[Toe])
+		{
+			// Pitch follows the heel to toe slope (handles steps), roll follows the averaged normal
+			const FVector ToeDirection = (Samples[Toe] - Samples[Heel]).GetSafeNormal();
+			const FVector Side = ToeDirection ^ (Normals[Heel] + Normals[Toe]).GetSafeNormal();
+			GroundUp = (Side ^ ToeDirection).GetSafeNormal();
+			Leg.TargetOffset = FMath::Max(Samples[Heel].Z, Samples[Toe].Z);
+		}
+		else
+		{
+			const int32 Sample = Hits[Heel] ? Heel : Toe;
+			GroundUp = Normals[Sample];
+			Leg.TargetOffset = Samples[Sample].Z;
+		}
+
+		Leg.bGroundHit = true;
+		Leg.TargetOffset = FMath::Clamp(Leg.TargetOffset, -this->TraceDepth, this->TraceHeight);
+		Leg.TargetRotation = GroundUp.IsNearlyZero() ? FQuat::Identity : FQuat::FindBetweenNormals(FVector::UpVector, GroundUp);
+	}
+}
+
+void FAnimNode_IKFootPlacement::SolveLeg(FIKFootPlacementLeg& Leg, FCSPose<FCompactPose>& Pose, 
+	const FTransform& ComponentTransform, TArray<FBoneTransform>& OutBoneTransforms)
+{
+	// Smooth towards the sampled ground
+	if (this->bFirstUpdate)
+	{
+		Leg.Offset = Leg.TargetOffset;
+		Leg.Rotation = Leg.TargetRotation;
+	}
+	else
+	{
+		Leg.Offset = FMath::FInterpTo(Leg.Offset, Leg.TargetOffset, this->DeltaTime, this->FootInterpSpeed);
+		Leg.Rotation = FMath::QInterpTo(Leg.Rotation, Leg.TargetRotation, this->DeltaTime, this->FootInterpSpeed);
+	}
+
+	// The whole chain moves down with the pelvis
+	const FVector PelvisShift = FVector(0.0f, 0.0f, this->PelvisOffset);
+	FTransform Thigh = Pose.GetComponentSpaceTransform(Leg.ThighIndex);
+	FTransform Calf = Pose.GetComponentSpaceTransform(Leg.CalfIndex);
+	FTransform Foot = Pose.GetComponentSpaceTransform(Leg.FootIndex);
+	const FVector AnimatedFoot = Foot.GetLocation();
+	Thigh.AddToTranslation(PelvisShift);
+	Calf.AddToTranslation(PelvisShift);
+	Foot.AddToTranslation(PelvisShift);
+
+	// The animated foot height is relative to the root, so the ground offset is added on top of it
+	FVector Target = AnimatedFoot + FVector(0.0f, 0.0f, Leg.Offset);
+
+	// Lock planted feet in world space so they don't slide while the body catches up with the head
+	const FVector TargetWorld = ComponentTransform.TransformPosition(Target);
+	if (this->bEnableFootLocking && this->DeltaTime > 0.0f && !this->bFirstUpdate)
+	{
+		const float Speed = FVector::Dist2D(TargetWorld, Leg.LastLocation) / this->DeltaTime;
+		if (Speed < this->LockSpeedThreshold)
+		{
+			if (!Leg.bLocked) Leg.LockedLocation = TargetWorld;
+			Leg.bLocked = true;
+		}
+		else Leg.bLocked = false;
+
+		Leg.LockAlpha = FMath::FInterpTo(Leg.LockAlpha, Leg.bLocked ? 1.0f : 0.0f, this->DeltaTime, this->LockBlendSpeed);
+	}
+	else
+	{
+		Leg.bLocked = false;
+		Leg.LockAlpha = 0.0f;
+	}
+	Leg.LastLocation = TargetWorld;
+
+	if (Leg.LockAlpha > KINDA_SMALL_NUMBER)
+	{
+		const FVector Locked = ComponentTransform.InverseTransformPosition(Leg.LockedLocation);
+		Target.X = FMath::Lerp(Target.X, Locked.X, Leg.LockAlpha);
+		Target.Y = FMath::Lerp(Target.Y, Locked.Y, Leg.LockAlpha);
+	}
+
+	// Solve the leg, keeping the knee in its animated plane
+	AnimationCore::SolveTwoBoneIK(Thigh, Calf, Foot, Calf.GetLocation(), Target, false, 1.0f, 1.0f);
+	Foot.SetRotation(Leg.Rotation * Foot.GetRotation());
+
+	OutBoneTransforms.Add(FBoneTransform(Leg.ThighIndex, Thigh));
+	OutBoneTransforms.Add(FBoneTransform(Leg.CalfIndex, Calf));
+	OutBoneTransforms.Add(FBoneTransform(Leg.FootIndex, Foot));
+}
+
+void FAnimNode_IKFootPlacement::EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms)
+{
+	check(OutBoneTransforms.Num() == 0);
+
+	const FTransform& ComponentTransform = Output.AnimInstanceProxy->GetComponentTransform();
+	const FBoneContainer& RequiredBones = Output.Pose.GetPose().GetBoneContainer();
+	const FCompactPoseBoneIndex PelvisIndex = this->PelvisBone.GetCompactPoseIndex(RequiredBones);
+
+	this->SampleGround(Output,
+		Output.Pose.GetComponentSpaceTransform(this->LeftLeg.FootIndex),
+		Output.Pose.GetComponentSpaceTransform(this->RightLeg.FootIndex));
+
+	// Lower the pelvis so the lowest foot can still reach the ground
+	float TargetPelvisOffset = 0.0f;
+	if (this->LeftLeg.bGroundHit) TargetPelvisOffset = FMath::Min(TargetPelvisOffset, this->LeftLeg.TargetOffset);
+	if (this->RightLeg.bGroundHit) TargetPelvisOffset = FMath::Min(TargetPelvisOffset, this->RightLeg.TargetOffset);
+	TargetPelvisOffset = FMath::Max(TargetPelvisOffset, -this->MaxPelvisOffset);
+
+	this->PelvisOffset = this->bFirstUpdate ? TargetPelvisOffset
+		: FMath::FInterpTo(this->PelvisOffset, TargetPelvisOffset, this->DeltaTime, this->PelvisInterpSpeed);
+
+	FTransform Pelvis = Output.Pose.GetComponentSpaceTransform(PelvisIndex);
+	Pelvis.AddToTranslation(FVector(0.0f, 0.0f, this->PelvisOffset));
+	OutBoneTransforms.Add(FBoneTransform(PelvisIndex, Pelvis));
+
+	this->SolveLeg(this->LeftLeg, Output.Pose, ComponentTransform, OutBoneTransforms);
+	this->SolveLeg(this->RightLeg, Output.Pose, ComponentTransform, OutBoneTransforms);
+	this->bFirstUpdate = false;
+
+	// Bone transforms have to be applied parent first
+	OutBoneTransforms.Sort(FCompareBoneTransformIndex());
+}
@@ -10,9 +10,13 @@
 #include "Animation/IKCharacterAnimInstance.h"
 #include "Library/AnimationStructLibrary.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "UnrealBody.h"
+#include "Subsystems/IKBodySubsystem.h"
 
 DEFINE_LOG_CATEGORY(LogIKBodyAnimation);
 
+DECLARE_CYCLE_STAT(TEXT("Anim Update"), STAT_IKBody_AnimUpdate, STATGROUP_IKBody);
+
 void UIKCharacterAnimInstance::NativeInitializeAnimation()
 {
 	Super::NativeInitializeAnimation();
@@ -36,18 +40,46 @@ void UIKCharacterAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 		return;
 	}
 
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_AnimUpdate);
+
 	this->BodyComponent = Cast<UIKBodyComponent>(Character->GetComponentByClass(UIKBodyComponent::StaticClass()));
+	if (this->BodyComponent != nullptr && this->BodyComponent->IsHeadless())
+	{
+		// Head, arm, finger and foot IK are cosmetic, a headless server only needs locomotion
+		UpdateMovementValues();
+		return;
+	}
+
 	if (this->BodyComponent != nullptr)
 	{
 		UpdateHandValues();
 		UpdateHeadValues();
 		UpdateMovementValues();
+
+		// Remember the poses the arm and head IK use, so the late update can correct them before rendering
+		this->BodyComponent->LatchTrackedPoses();
+
+		// Sample hand input as late as possible so the fingers use the newest tracking data
+		this->BodyComponent->SampleHandInput();
 		UpdateFingerIKValues();
 	}
 	else UE_LOG(LogIKBodyAnimation, Warning, TEXT("Pawn owner has no IKBodyComponent"));
 
-	// Feet IK doesn't need any component references
-	UpdateFootIK();
+	// Climbing bodies hang from their hands, their feet aren't placed on the ground
+	if (this->BodyComponent != nullptr && this->BodyComponent->IsClimbing())
+	{
+		FootIKValues = FAnimGraphFootIK();
+		return;
+	}
+
+	// Feet IK doesn't need any component references, but traces less often when the budget allocator or frame time governor reduces work
+	this->FootIKPendingTime += DeltaSeconds;
+	const bool WorkReduced = this->BodyComponent != nullptr && this->BodyComponent->IsFootWorkReduced();
+	if (!bUseNativeFootPlacement && (!WorkReduced || this->FootIKPendingTime >= this->BodyComponent->ReducedWorkInterval))
+	{
+		UpdateFootIK();
+		this->FootIKPendingTime = 0.0f;
+	}
 }
 
 void UIKCharacterAnimInstance::UpdateFootIK()
@@ -85,9 +117,19 @@ void UIKCharacterAnimInstance::TraceFoot(FVector Foot, FVector* ResultLocation,
 	const FVector Start = FVector(Foot.X, Foot.Y, ZRoot + 60);
 	const FVector End = FVector(Foot.X, Foot.Y, ZRoot);
 
-	// Trace
+	// Sample the baked ground when the level has a cache, trace otherwise.
+	// The cache only keeps the top-most surface, a height outside the trace range is another floor (e.g. a bridge above) and is traced live.
 	FHitResult HitResult; // Establish Hit Result
-	World->LineTraceSingleByChannel(HitResult, Start, End, ECC_Visibility, *Params);
+	float GroundHeight = 0.0f;
+	FVector GroundNormal;
+	const UIKBodySubsystem* Subsystem = World->GetSubsystem<UIKBodySubsystem>();
+	if (Subsystem != nullptr && Subsystem->SampleCachedGround(Foot, GroundHeight, GroundNormal) && GroundHeight >= End.Z && GroundHeight <= Start.Z)
+	{
+		HitResult.bBlockingHit = true;
+		HitResult.Location = FVector(Foot.X, Foot.Y, GroundHeight);
+		HitResult.ImpactNormal = GroundNormal;
+	}
+	else World->LineTraceSingleByChannel(HitResult, Start, End, ECC_Visibility, *Params);
 
 	// Check for hit
 	if (HitResult.bBlockingHit)
@@ -120,14 +162,26 @@ void UIKCharacterAnimInstance::TraceFoot(FVector Foot, FVector* ResultLocation,
 
 void UIKCharacterAnimInstance::UpdateHeadValues()
 {
-	if (!this->BodyComponent->Camera) return;
+	// Pose streams record the camera, the offset is applied the same way as for a live camera
+	if (const FIKPoseFrame* Playback = this->BodyComponent->GetPlaybackFrame())
+	{
+		HeadIKValues.HeadRotation = Playback->Head.Rotator();
+		HeadIKValues.HeadLocation = Playback->Head.GetLocation() + (UKismetMathLibrary::GetForwardVector(HeadIKValues.HeadRotation) * this->BodyComponent->BodyOffset);
+		return;
+	}
+
+	if (!this->BodyComponent->HasTrackedInput()) return;
 	
 	// Simply set head values to match camera at all times.
-	HeadIKValues.HeadRotation = this->BodyComponent->Camera->GetComponentRotation();
-	HeadIKValues.HeadLocation = this->BodyComponent->Camera->GetComponentLocation();
+	const FTransform& Head = this->BodyComponent->GetTrackedPoses().Head;
+	HeadIKValues.HeadRotation = Head.Rotator();
 
-	// Apply the same offset as the component does
-	HeadIKValues.HeadLocation += (UKismetMathLibrary::GetForwardVector(HeadIKValues.HeadRotation) * this->BodyComponent->BodyOffset);
+	// Use the location solved with the body this frame, or apply the same offset as the component does
+	if (!this->BodyComponent->GetSolvedHeadLocation(HeadIKValues.HeadLocation))
+	{
+		HeadIKValues.HeadLocation = Head.GetLocation();
+		HeadIKValues.HeadLocation += (UKismetMathLibrary::GetForwardVector(HeadIKValues.HeadRotation) * this->BodyComponent->BodyOffset);
+	}
 }
 
 void UIKCharacterAnimInstance::UpdateHandValues()
@@ -135,7 +189,10 @@ void UIKCharacterAnimInstance::UpdateHandValues()
 	const USkeletalMeshComponent* OwnerComp = GetOwningComponent();
 	if (!OwnerComp) return;
 
-	if (!this->BodyComponent->LeftController || !this->BodyComponent->RightController)
+	// Controller transforms come from the pose stream while playing one back
+	const FIKPoseFrame* Playback = this->BodyComponent->GetPlaybackFrame();
+	const FIKTrackedPoses& Poses = this->BodyComponent->GetTrackedPoses();
+	if (Playback == nullptr && (!Poses.bLeftHandTracked || !Poses.bRightHandTracked))
 	{
 		UE_LOG(LogIKBodyAnimation, Warning, TEXT("Unable to get controller transforms. This is normal in animation preview, but a setup issue in game."))
 		return;
@@ -149,8 +206,10 @@ void UIKCharacterAnimInstance::UpdateHandValues()
 	LeftOffset.ScaleTranslation(-1);
 
 	// Get controller transform * offset
-	ArmIKValues.LeftTargetTransform = this->BodyComponent->LeftController->GetComponentTransform() * LeftOffset;
-	ArmIKValues.RightTargetTransform = this->BodyComponent->RightController->GetComponentTransform() * RightOffset;
+	const FTransform LeftController = Playback != nullptr ? Playback->LeftHand : Poses.LeftHand;
+	const FTransform RightController = Playback != nullptr ? Playback->RightHand : Poses.RightHand;
+	ArmIKValues.LeftTargetTransform = LeftController * LeftOffset;
+	ArmIKValues.RightTargetTransform = RightController * RightOffset;
 }
 
 void UIKCharacterAnimInstance::UpdateMovementValues()
@@ -161,12 +220,24 @@ void UIKCharacterAnimInstance::UpdateMovementValues()
 
 void UIKCharacterAnimInstance::UpdateFingerIKValues()
 {
-	// This is probably kinda inefficient, gotta find a way to directly access the FingerIKBlendmap with a pointer to replace it's value. 
-	// Direct ref to anim? (cross dep tho)
-	for (const TPair<EFingerBone, float>& pair : this->BodyComponent->FingerIKValues.BlendMap)
+	const FIKFingerJointTables& Tables = this->BodyComponent->GetJointTables();
+	const TArray<float>& Alphas = this->BodyComponent->GetJointAlphas();
+
+	// The body keeps changing its alphas on the game thread, the anim graph reads this copy from worker threads
+	this->FingerJointAlphas = Alphas;
+
+	// Joints that exist on the mannequin also drive the blend map used by ABP_IKBody
+	for (int32 Joint = 0; Joint < Tables.Joints.Num(); ++Joint)
 	{
-		const EFingerBone Bone = pair.Key;
-		const float Alpha = pair.Value;
-		*this->FingerIKValues.BlendMap.Find(Bone) = Alpha;
+		const int8 BlendMapBone = Tables.Joints[Joint].BlendMapBone;
+		if (BlendMapBone == INDEX_NONE) continue;
+
+		float* Alpha = this->FingerIKValues.BlendMap.Find((EFingerBone) BlendMapBone);
+		if (Alpha != nullptr) *Alpha = Alphas[Joint];
 	}
-}
\ No newline at end of file
+}
+
+float UIKCharacterAnimInstance::GetFingerJointAlpha(int32 Joint) const
+{
+	return this->FingerJointAlphas.IsValidIndex(Joint) ? this->FingerJointAlphas[Joint] : 0.0f;
+}
@@ -9,16 +9,146 @@
 
 #include "CharacterComponents/IKBodyComponent.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "UnrealBody.h"
+#include "Subsystems/IKBodySubsystem.h"
+#include "Subsystems/IKBodyQualityGovernor.h"
+#include "IAnimationBudgetAllocator.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "MotionControllerComponent.h"
+#include "IMotionController.h"
+#include "IXRTrackingSystem.h"
+#include "Features/IModularFeatures.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+#include "Animation/IKCharacterAnimInstance.h"
 
 DEFINE_LOG_CATEGORY(LogIKBodyComponent);
 
+static float GIKBodyAnimBudgetMs = 0.0f;
+
+static void OnIKBodyAnimBudgetChanged(IConsoleVariable* Variable)
+{
+	if (GIKBodyAnimBudgetMs <= 0.0f)
+		return;
+
+	// Forward to the allocator, which picks up changes to its own budget variable
+	if (IConsoleVariable* BudgetMs = IConsoleManager::Get().FindConsoleVariable(TEXT("a.Budget.BudgetMs")))
+	{
+		BudgetMs->Set(GIKBodyAnimBudgetMs, ECVF_SetByConsole);
+	}
+}
+
+static FAutoConsoleVariableRef CVarIKBodyAnimBudgetMs(
+	TEXT("IKBody.AnimBudgetMs"),
+	GIKBodyAnimBudgetMs,
+	TEXT("Millisecond budget for the animation of IK bodies registered with the animation budget allocator. 0 keeps the allocator's own budget."),
+	FConsoleVariableDelegate::CreateStatic(&OnIKBodyAnimBudgetChanged));
+
+static int32 GIKBodyLateUpdateMeasure = 0;
+static FAutoConsoleVariableRef CVarIKBodyLateUpdateMeasure(
+	TEXT("IKBody.LateUpdate.Measure"),
+	GIKBodyLateUpdateMeasure,
+	TEXT("Latency measurement for the hand and head late update. 1 logs the latch to late update time and the applied correction of every body each frame."));
+
+static void IKBodyMemReport(const TArray<FString>& Args)
+{
+	const int32 NumAvatars = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 256;
+
+	// Bytes per part, summed over all live bodies. Every body reports the same parts in the same order.
+	TArray<TPair<const TCHAR*, SIZE_T>> Totals;
+	int32 NumBodies = 0;
+	for (TObjectIterator<UIKBodyComponent> It; It; ++It)
+	{
+		if (It->IsTemplate() || It->GetWorld() == nullptr) continue;
+
+		TArray<TPair<const TCHAR*, SIZE_T>> Parts;
+		It->AppendMemoryReport(Parts);
+		if (Totals.Num() == 0) Totals = Parts;
+		else for (int32 Part = 0; Part < Parts.Num(); ++Part) Totals[Part].Value += Parts[Part].Value;
+		++NumBodies;
+	}
+
+	if (NumBodies > 0)
+	{
+		SIZE_T PerAvatar = 0;
+		UE_LOG(LogIKBodyComponent, Display, TEXT("IKBody memory, %d live bodies, bytes per avatar:"), NumBodies);
+		for (const TPair<const TCHAR*, SIZE_T>& Part : Totals)
+		{
+			UE_LOG(LogIKBodyComponent, Display, TEXT("  %-24s %8llu"), Part.Key, (uint64) (Part.Value / NumBodies));
+			PerAvatar += Part.Value / NumBodies;
+		}
+		UE_LOG(LogIKBodyComponent, Display, TEXT("  %-24s %8llu, %.1f KB for %d avatars"), TEXT("Total"), (uint64) PerAvatar, PerAvatar * NumAvatars / 1024.0, NumAvatars);
+	}
+	else UE_LOG(LogIKBodyComponent, Display, TEXT("IKBody memory, no live bodies"));
+
+	// Per-tick finger and body state of a mannequin body, compared to per-bone maps and full transforms for the same state.
+	// Both include the anim instance's copy of the alphas: the blend map ABP_IKBody reads, and the joint array for GetFingerJointAlpha.
+	TArray<FIKHandDefinition> Hands;
+	UIKBodySkeletonProfile::GetMannequinHands(Hands);
+	FIKFingerJointTables Tables;
+	Tables.Build(Hands);
+	const int32 NumJoints = Tables.Joints.Num();
+
+	FAnimGraphFingerIK BoneAlphas;
+	TMap<EFingerBone, bool> BoneFinished;
+	TMap<EFingerBone, UCapsuleComponent*> BoneHitboxes;
+	for (const TPair<EFingerBone, float>& Bone : BoneAlphas.BlendMap)
+	{
+		BoneFinished.Add(Bone.Key, false);
+		BoneHitboxes.Add(Bone.Key, nullptr);
+	}
+
+	TArray<float> JointAlphas;
+	JointAlphas.SetNumZeroed(NumJoints);
+	TBitArray<> JointBits(false, NumJoints);
+	TArray<UCapsuleComponent*> JointHitboxes;
+	JointHitboxes.SetNumZeroed(NumJoints);
+
+	const SIZE_T MapState = 2 * BoneAlphas.BlendMap.GetAllocatedSize() + BoneFinished.GetAllocatedSize() + BoneHitboxes.GetAllocatedSize()
+		+ sizeof(FTransform) + 3 * sizeof(FVector) + 2 * sizeof(FRotator) + sizeof(float) + 3 * sizeof(bool);
+	const SIZE_T CompactState = 2 * JointAlphas.GetAllocatedSize() + BoneAlphas.BlendMap.GetAllocatedSize() + 2 * JointBits.GetAllocatedSize() + JointHitboxes.GetAllocatedSize()
+		+ sizeof(FIKBodyTickState);
+
+	UE_LOG(LogIKBodyComponent, Display, TEXT("Hot per-tick state of a %d joint body and its anim instance: %llu bytes (tick state %d bytes, one cache line), %llu bytes as per-bone maps and transforms"),
+		NumJoints, (uint64) CompactState, (int32) sizeof(FIKBodyTickState), (uint64) MapState);
+	UE_LOG(LogIKBodyComponent, Display, TEXT("%d avatars: %.1f KB instead of %.1f KB (-%.0f%%)"),
+		NumAvatars, CompactState * NumAvatars / 1024.0, MapState * NumAvatars / 1024.0, 100.0 * (1.0 - (double) CompactState / MapState));
+}
+
+static FAutoConsoleCommand CmdIKBodyMemReport(
+	TEXT("IKBody.MemReport"),
+	TEXT("Logs the bytes per avatar of every part of the live IK bodies and projects them to a scene. Optional argument: number of avatars (256)."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&IKBodyMemReport));
+
+DECLARE_CYCLE_STAT(TEXT("Late Update"), STAT_IKBody_LateUpdate, STATGROUP_IKBody);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Late Update Latency (ms)"), STAT_IKBody_LateUpdateLatency, STATGROUP_IKBody);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Late Update Correction (cm)"), STAT_IKBody_LateUpdateCorrection, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Pose Recording"), STAT_IKBody_PoseRecording, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Pose Playback"), STAT_IKBody_PosePlayback, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Body Movement"), STAT_IKBody_TickBodyMovement, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Body Placement Sweep"), STAT_IKBody_PlacementSweep, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Climb Solve"), STAT_IKBody_ClimbSolve, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Climb Solve Iterations"), STAT_IKBody_ClimbSolveIterations, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Placement Sweeps"), STAT_IKBody_PlacementSweeps, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Placement Sweeps Blocked"), STAT_IKBody_PlacementSweepsBlocked, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Finger IK"), STAT_IKBody_TickFingerIK, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Finger Contact Queries"), STAT_IKBody_FingerContactQueries, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Grip Prewarm"), STAT_IKBody_GripPrewarm, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Prewarmed Grips"), STAT_IKBody_PrewarmedGrips, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Sample Hand Input"), STAT_IKBody_SampleHandInput, STATGROUP_IKBody);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Hand Input Latency (ms)"), STAT_IKBody_HandInputLatency, STATGROUP_IKBody);
+
 // Sets default values for this component's properties
+PRAGMA_DISABLE_DEPRECATION_WARNINGS
 UIKBodyComponent::UIKBodyComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
 	PrimaryComponentTick.TickInterval = .01f;
 	SetNetAddressable();
 }
+PRAGMA_ENABLE_DEPRECATION_WARNINGS
 
 void UIKBodyComponent::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
 {
@@ -34,87 +164,338 @@ void UIKBodyComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (Body != nullptr && Camera != nullptr)
-	{
-		// Detach the body from it's parent so it doesn't automatically move with the players head movement.
-		static FDetachmentTransformRules DetachRules 
-			= FDetachmentTransformRules(EDetachmentRule::KeepWorld, false);
-		Body->DetachFromComponent(DetachRules);
+	this->DefaultTickInterval = GetComponentTickInterval();
 
-		// Set body at camera position + offsets
-		this->BodyTargetLocation = Camera->GetComponentLocation()
-			+ (UKismetMathLibrary::GetForwardVector(Camera->GetComponentRotation()) * BodyOffset); // 20 units back from cam to avoid clipping
-		this->BodyTargetLocation.Z -= this->PlayerHeight;
-		this->Body->SetWorldLocation(this->BodyTargetLocation);
+	this->EnsureJointTables();
 
-		// Rotate Body to match
-		this->BodyTargetRotation.Yaw = Camera->GetComponentRotation().Yaw + this->BodyRotationOffset;
-		this->Body->SetWorldRotation(this->BodyTargetRotation);
+	if (Body != nullptr)
+	{
+		this->DefaultAnimTickOption = Body->VisibilityBasedAnimTickOption;
+	}
+
+	this->UpdateHeadless();
+	if (!this->TickState.bHeadless && this->bUseAnimationBudget)
+	{
+		this->RegisterWithAnimationBudget();
+	}
 
-		// Set current position to match target
-		this->BodyCurrentLocation = this->BodyTargetLocation;
-		this->BodyCurrentRotation = this->BodyTargetRotation; 
-				
-		UE_LOG(LogIKBodyComponent, Log, TEXT("Succesfully initialized with body and camera!"));
+	if (Body != nullptr && this->HasTrackedInput())
+	{
+		this->InitializeBody();
 	}
 	else
 	{
 		// Body should be assigned in component owner's construction script!
-		UE_LOG(LogIKBodyComponent, Warning, TEXT("Please ensure a body and camera reference are set before BeginPlay by setting it in the owner's construction script."));
+		UE_LOG(LogIKBodyComponent, Warning, TEXT("Please ensure a body and camera reference (or a body input source) are set before BeginPlay by setting it in the owner's construction script."));
+	}
+}
+
+void UIKBodyComponent::InitializeBody()
+{
+	// Detach the body from it's parent so it doesn't automatically move with the players head movement.
+	static FDetachmentTransformRules DetachRules 
+		= FDetachmentTransformRules(EDetachmentRule::KeepWorld, false);
+	Body->DetachFromComponent(DetachRules);
+
+	// Set body at camera position + offsets
+	const FTransform& Head = this->GetTrackedPoses().Head;
+	FVector TargetLocation = Head.GetLocation()
+		+ (UKismetMathLibrary::GetForwardVector(Head.Rotator()) * BodyOffset); // 20 units back from cam to avoid clipping
+	TargetLocation.Z -= this->PlayerHeight;
+	this->Body->SetWorldLocation(TargetLocation);
+
+	// Rotate Body to match
+	this->TickState.TargetYaw = Head.Rotator().Yaw + this->BodyRotationOffset;
+	this->Body->SetWorldRotation(FRotator(0.0f, this->TickState.TargetYaw, 0.0f));
+
+	// Set current position to match target
+	this->TickState.TargetLocation = FVector2f(TargetLocation.X, TargetLocation.Y);
+	this->TickState.PlacementTarget = this->TickState.TargetLocation;
+	this->TickState.CurrentLocation = this->TickState.TargetLocation;
+	this->TickState.CurrentYaw = this->TickState.TargetYaw;
+			
+	// Solve together with the other bodies in the world
+	if (UIKBodySubsystem* Subsystem = GetWorld()->GetSubsystem<UIKBodySubsystem>())
+	{
+		Subsystem->RegisterBody(this);
+	}
+
+	UE_LOG(LogIKBodyComponent, Log, TEXT("Succesfully initialized with body and camera!"));
+}
+
+void UIKBodyComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	this->StopPoseRecording();
+	this->StopPosePlayback();
+
+	if (UIKBodySubsystem* Subsystem = GetWorld() != nullptr ? GetWorld()->GetSubsystem<UIKBodySubsystem>() : nullptr)
+	{
+		Subsystem->UnregisterBody(this);
 	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UIKBodyComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	if (Body != nullptr && Camera != nullptr)
+	// A body playing back a pose stream doesn't need a camera or controllers
+	if (this->PoseReader.IsValid())
+	{
+		this->TickPosePlayback(DeltaTime);
+		return;
+	}
+
+	if (Body != nullptr && this->HasTrackedInput())
 	{
+		// The frame time governor slows down the whole body at its lowest quality level
+		const EIKBodyQualityLevel Quality = FIKBodyQualityGovernor::Get().GetLevel();
+		const float TickInterval = Quality >= EIKBodyQualityLevel::ReducedBodyTick ? this->GovernedBodyTickInterval : this->DefaultTickInterval;
+		if (GetComponentTickInterval() != TickInterval) SetComponentTickInterval(TickInterval);
+
 		this->TickBodyMovement(DeltaTime);
-		this->TickFingerIK(DeltaTime);
+
+		if (this->BudgetedBody != nullptr)
+		{
+			this->UpdateBudgetSignificance();
+		}
+
+		// Finger interpolation is cosmetic, headless servers only keep the grip states
+		if (!this->TickState.bHeadless)
+		{
+			// Under budget pressure the fingers update less often, interpolating over the skipped time
+			const bool ReduceFingers = this->TickState.bWorkReduced || Quality >= EIKBodyQualityLevel::ReducedFingerContacts;
+			this->TickState.FingerIKPendingTime += DeltaTime;
+			if (!ReduceFingers || this->TickState.FingerIKPendingTime >= this->ReducedWorkInterval)
+			{
+				this->TickFingerIK(this->TickState.FingerIKPendingTime);
+				this->TickState.FingerIKPendingTime = 0.0f;
+			}
+
+			// Look for grippables around the hands at a low frequency
+			this->GripPrewarmPendingTime += DeltaTime;
+			if (this->bPrewarmGrips && this->GripPrewarmPendingTime >= this->GripPrewarmInterval)
+			{
+				this->TickGripPrewarm();
+				this->GripPrewarmPendingTime = 0.0f;
+			}
+		}
+
+		if (this->PoseWriter.IsValid())
+		{
+			this->RecordPose(DeltaTime);
+		}
+	}
+}
+
+bool UIKBodyComponent::IsFootWorkReduced() const
+{
+	return this->TickState.bWorkReduced || FIKBodyQualityGovernor::Get().GetLevel() >= EIKBodyQualityLevel::ReducedFootTraces;
+}
+
+/*
+ * Nobody renders the body on a dedicated server, only the root transform and grip states matter there.
+ * Bodies driven by a body input source are bots, which are there to load the full pipeline, so they stay out of headless mode unless asked.
+*/
+void UIKBodyComponent::UpdateHeadless()
+{
+	const bool bHeadless = this->bHeadlessOnDedicatedServer && GetNetMode() == NM_DedicatedServer
+		&& (this->BodyInputSource.GetObject() == nullptr || this->bHeadlessWithBodyInputSource);
+	this->TickState.bHeadless = bHeadless;
+
+	if (Body != nullptr)
+	{
+		Body->VisibilityBasedAnimTickOption = bHeadless && !this->bKeepServerHandHitboxes
+			? EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered : this->DefaultAnimTickOption;
+	}
+}
+
+void UIKBodyComponent::SaveTickSnapshot(FIKBodyTickSnapshot& OutSnapshot) const
+{
+	OutSnapshot.TickState = this->TickState;
+	OutSnapshot.BodyTransform = this->Body->GetComponentTransform();
+	OutSnapshot.AnimTickOption = this->Body->VisibilityBasedAnimTickOption;
+	OutSnapshot.TickInterval = GetComponentTickInterval();
+	OutSnapshot.HeadTargetLocation = this->HeadTargetLocation;
+	OutSnapshot.MovementDirection = this->MovementDirection;
+	OutSnapshot.MovementSpeed = this->MovementSpeed;
+	OutSnapshot.LastSolveFrame = this->LastSolveFrame;
+	OutSnapshot.ClimbSolver = this->ClimbSolver;
+	OutSnapshot.JointAlphas = this->JointAlphas;
+	OutSnapshot.JointFinished = this->JointFinished;
+	OutSnapshot.JointContact = this->JointContact;
+	OutSnapshot.JointContactAlphas = this->JointContactAlphas;
+	OutSnapshot.GripPrewarm[0] = this->GripPrewarm[0];
+	OutSnapshot.GripPrewarm[1] = this->GripPrewarm[1];
+	OutSnapshot.GripPrewarmPendingTime = this->GripPrewarmPendingTime;
+}
+
+void UIKBodyComponent::RestoreTickSnapshot(const FIKBodyTickSnapshot& Snapshot)
+{
+	this->TickState = Snapshot.TickState;
+	this->Body->SetWorldTransform(Snapshot.BodyTransform, false, nullptr, ETeleportType::TeleportPhysics);
+	this->Body->VisibilityBasedAnimTickOption = Snapshot.AnimTickOption;
+	if (GetComponentTickInterval() != Snapshot.TickInterval) SetComponentTickInterval(Snapshot.TickInterval);
+	this->HeadTargetLocation = Snapshot.HeadTargetLocation;
+	this->MovementDirection = Snapshot.MovementDirection;
+	this->MovementSpeed = Snapshot.MovementSpeed;
+	this->LastSolveFrame = Snapshot.LastSolveFrame;
+	this->ClimbSolver = Snapshot.ClimbSolver;
+	this->JointAlphas = Snapshot.JointAlphas;
+	this->JointFinished = Snapshot.JointFinished;
+	this->JointContact = Snapshot.JointContact;
+	this->JointContactAlphas = Snapshot.JointContactAlphas;
+
+	// Contact queries issued while ticking are dropped, the joints query again on the next tick
+	this->JointContactPending.Init(false, this->JointContactPending.Num());
+	++this->ContactGeneration[0];
+	++this->ContactGeneration[1];
+
+	for (const ECharacterIKHand Hand : { ECharacterIKHand::Left, ECharacterIKHand::Right })
+	{
+		// Hitboxes picked up for an approach that only happened while ticking go back to the pool
+		if (this->GripPrewarm[(uint8) Hand].bHitboxesAcquired && !Snapshot.GripPrewarm[(uint8) Hand].bHitboxesAcquired && !this->IsGripping(Hand))
+		{
+			this->ReleaseHandHitboxes(Hand);
+		}
+
+		this->GripPrewarm[(uint8) Hand] = Snapshot.GripPrewarm[(uint8) Hand];
+	}
+
+	this->GripPrewarmPendingTime = Snapshot.GripPrewarmPendingTime;
+}
+
+void UIKBodyComponent::RegisterWithAnimationBudget()
+{
+	this->BudgetedBody = Cast<USkeletalMeshComponentBudgeted>(this->Body);
+	if (this->BudgetedBody == nullptr)
+	{
+		UE_LOG(LogIKBodyComponent, Warning, TEXT("The animation budget requires the body to be a SkeletalMeshComponentBudgeted."));
+		return;
+	}
+
+	IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(GetWorld());
+	if (Allocator == nullptr)
+	{
+		this->BudgetedBody = nullptr;
+		return;
+	}
+
+	// Significance is provided by this component every tick
+	this->BudgetedBody->SetAutoCalculateSignificance(false);
+	this->BudgetedBody->OnReduceWork().BindUObject(this, &UIKBodyComponent::OnReduceWork);
+	Allocator->RegisterComponent(this->BudgetedBody);
+
+	// The allocator budgets every mesh in the world, whether it runs is up to the project (a.Budget.Enabled)
+	if (!Allocator->GetEnabled())
+	{
+		UE_LOG(LogIKBodyComponent, Log, TEXT("The animation budget allocator is disabled, the body is registered but won't be budgeted until a.Budget.Enabled is set."));
+	}
+
+	OnIKBodyAnimBudgetChanged(nullptr);
+}
+
+void UIKBodyComponent::UpdateBudgetSignificance()
+{
+	const APawn* Pawn = Cast<APawn>(this->GetOwner());
+	if (Pawn != nullptr && Pawn->IsLocallyControlled())
+	{
+		// The local player's own body is never throttled
+		this->BudgetedBody->SetComponentSignificance(1.0f, true, false, false);
+		return;
 	}
+
+	// Remote bodies lose significance with their distance to the nearest local view
+	float ClosestDistanceSquared = MAX_flt;
+	const FVector BodyLocation = this->Body->GetComponentLocation();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* Controller = It->Get();
+		if (Controller == nullptr || !Controller->IsLocalController())
+			continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, (float) FVector::DistSquared(ViewLocation, BodyLocation));
+	}
+
+	const float Distance = ClosestDistanceSquared == MAX_flt ? MAX_flt : FMath::Sqrt(ClosestDistanceSquared);
+	const float Significance = Distance == MAX_flt ? 0.0f : 1.0f / (1.0f + Distance / FMath::Max(this->BudgetSignificanceDistance, 1.0f));
+	this->BudgetedBody->SetComponentSignificance(Significance);
 }
 
 void UIKBodyComponent::TickBodyMovement(float DeltaTime)
 {
-	FTransform CameraCurrentPosition = this->Camera->GetComponentTransform();
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_TickBodyMovement);
+
+	// Climbing bodies hang from their grips instead of stepping after the head
+	if (this->IsClimbing())
+	{
+		this->TickClimbing();
+		return;
+	}
+
+	const FTransform& CameraCurrentPosition = this->GetTrackedPoses().Head;
 
-	// Calculate the XY distance moved
-	float DistanceMoved = FVector::Distance(
-		FVector(CameraCurrentPosition.GetLocation().X, CameraCurrentPosition.GetLocation().Y, 0),
-		FVector(LastCameraPosition.GetLocation().X, LastCameraPosition.GetLocation().Y, 0)
-	);
+	// Registered bodies were solved in one batch this frame, after their pawn moved.
+	// Bodies that aren't registered, joined after the batch, or step twice in a frame are solved on their own.
+	UIKBodySubsystem* Subsystem = GetWorld()->GetSubsystem<UIKBodySubsystem>();
+	const FIKBodySolveBatch* Batch = nullptr;
+	int32 Index = 0;
+	if (Subsystem != nullptr && this->SolveBatchFrame == GFrameCounter && this->LastSolveFrame != GFrameCounter)
+	{
+		Index = this->SolveBatchIndex;
+		Batch = &Subsystem->GetSolveBatch();
+	}
+	else
+	{
+		this->SingleBatch.SetNum(1);
+		this->GatherSolveInput(this->SingleBatch, 0);
+		this->SingleBatch.SolveScalar(0, 1);
+		Batch = &this->SingleBatch;
+	}
 
-	// Calculate Yaw difference
-	float YawDifference = UKismetMathLibrary::Abs(
-		CameraCurrentPosition.GetRotation().Rotator().Yaw - LastCameraPosition.GetRotation().Rotator().Yaw
-	);
+	this->LastSolveFrame = GFrameCounter;
+	this->HeadTargetLocation = FVector(Batch->TargetX[Index], Batch->TargetY[Index], Batch->TargetZ[Index]);
+	const int32 Flags = Batch->Flags[Index];
 
 	// Update the camera position and movement if the player moved further away than threshold (enables leaning/ head tilt without moving the body)
-	if (DistanceMoved > this->MovementThreshold)
+	FIKBodyTickState& State = this->TickState;
+	if (Flags & EIKBodySolveFlags::Moved)
 	{
-		// Set new body target location
-		this->BodyTargetLocation = CameraCurrentPosition.GetLocation() 
-			+ (UKismetMathLibrary::GetForwardVector(CameraCurrentPosition.GetRotation().Rotator()) * BodyOffset); // 20 units back from cam to avoid clipping
+		// Set new body target location, 20 units back from cam to avoid clipping
+		State.TargetLocation = FVector2f(this->HeadTargetLocation.X, this->HeadTargetLocation.Y);
+		State.PlacementTarget = State.TargetLocation;
 
 		// Update movement speed and direction
-		this->MovementDirection = GetMovementDirection(&LastCameraPosition, &CameraCurrentPosition);
-		this->MovementSpeed = UKismetMathLibrary::FFloor((DistanceMoved / DeltaTime) / 1000);
+		this->MovementDirection = Batch->Direction[Index];
+		this->MovementSpeed = FMath::FloorToFloat((Batch->Distance[Index] / DeltaTime) / 1000);
 
 		// Save new position
-		this->LastCameraPosition = CameraCurrentPosition;
+		const FVector CameraLocation = CameraCurrentPosition.GetLocation();
+		State.LastCameraLocation = FVector2f(CameraLocation.X, CameraLocation.Y);
+		State.LastCameraForward = FVector3f(CameraCurrentPosition.GetRotation().GetForwardVector());
+		State.LastCameraYaw = CameraCurrentPosition.GetRotation().Rotator().Yaw;
 	}
 
 	// Apply new rotation to the body if turned far enough (allows head turning without rotating the whole body)
-	if (YawDifference > this->RotationThreshold)
+	if (Flags & EIKBodySolveFlags::Rotated)
+	{
+		State.TargetYaw = CameraCurrentPosition.GetRotation().Rotator().Yaw + this->BodyRotationOffset;
+		this->MovementDirection = Batch->YawDifference[Index];
+	}
+
+	// The placement only changes when the body steps or turns, so it is swept at most once per step
+	if (this->bCollisionAwarePlacement && (Flags & (EIKBodySolveFlags::Moved | EIKBodySolveFlags::Rotated)))
 	{
-		this->BodyTargetRotation.Yaw = Camera->GetComponentRotation().Yaw + this->BodyRotationOffset;
-		this->MovementDirection = YawDifference;
+		this->SweepBodyPlacement(CameraCurrentPosition.GetLocation());
 	}
 
 	// If the body hasn't reached it's target location yet we move it towards it.
-	if (UKismetMathLibrary::NearlyEqual_FloatFloat(BodyCurrentLocation.X, BodyTargetLocation.X, 9.99997f) 
-		&& UKismetMathLibrary::NearlyEqual_FloatFloat(BodyCurrentLocation.Y, BodyTargetLocation.Y, 9.99997f))
+	if (FMath::IsNearlyEqual(State.CurrentLocation.X, State.TargetLocation.X, 9.99997f) 
+		&& FMath::IsNearlyEqual(State.CurrentLocation.Y, State.TargetLocation.Y, 9.99997f))
 	{
 		this->MovementSpeed = 0;
 		this->MovementDirection = 0;
@@ -122,96 +503,284 @@ void UIKBodyComponent::TickBodyMovement(float DeltaTime)
 	else
 	{
 		// Tick towards location based on movement speed
-		this->BodyCurrentLocation = UKismetMathLibrary::VInterpTo(this->BodyCurrentLocation, this->BodyTargetLocation, DeltaTime, MovementSpeed * this->MovementSpeedMultiplier);
-		this->Body->SetWorldLocation(BodyCurrentLocation);
+		State.CurrentLocation = FVector2f(FMath::Vector2DInterpTo(FVector2D(State.CurrentLocation), FVector2D(State.TargetLocation), DeltaTime, MovementSpeed * this->MovementSpeedMultiplier));
 	}
 
 	// If the body hasn't reached it's target rotation yet we interp towards it.
-	if (!UKismetMathLibrary::NearlyEqual_FloatFloat(BodyCurrentRotation.Yaw, BodyTargetRotation.Yaw, 9.99997f))
+	if (!FMath::IsNearlyEqual(State.CurrentYaw, State.TargetYaw, 9.99997f))
 	{
-		BodyCurrentRotation.Yaw = UKismetMathLibrary::FInterpTo(BodyCurrentRotation.Yaw, BodyTargetRotation.Yaw, DeltaTime, UKismetMathLibrary::Max(2.0f, MovementSpeed));
-		this->Body->SetWorldRotation(BodyCurrentRotation);
+		State.CurrentYaw = FMath::FInterpTo(State.CurrentYaw, State.TargetYaw, DeltaTime, FMath::Max(2.0f, MovementSpeed));
+		this->Body->SetWorldRotation(FRotator(0.0f, State.CurrentYaw, 0.0f));
 	}
 	else this->MovementDirection = 0;
 
 	// Always set Z to enable seamless crouching
-	FVector BodyLocation = FVector(BodyCurrentLocation.X, BodyCurrentLocation.Y, CameraCurrentPosition.GetLocation().Z - this->PlayerHeight);
+	FVector BodyLocation = FVector(State.CurrentLocation.X, State.CurrentLocation.Y, CameraCurrentPosition.GetLocation().Z - this->PlayerHeight);
 	this->Body->SetWorldLocation(BodyLocation);
 }
 
-/*
- * Sets the body target position to the camera position, rotating and moving it down so that the character eyes match the HMD position
-*/
-void UIKBodyComponent::SetBodyTargetPosition(FTransform* CameraTransform)
+void UIKBodyComponent::BeginClimbing()
+{
+	if (this->Body == nullptr || this->IsClimbing())
+		return;
+
+	// Start from where the body stands, the solve continues from its last solution every tick
+	this->ClimbSolver.Reset(this->Body->GetComponentLocation(), this->TickState.CurrentYaw - this->BodyRotationOffset);
+	this->TickState.CharacterState = ECharacterState::Climbing;
+	this->MovementSpeed = 0.0f;
+	this->MovementDirection = 0.0f;
+}
+
+void UIKBodyComponent::EndClimbing()
+{
+	if (!this->IsClimbing())
+		return;
+
+	// Walk on from where the body let go, without stepping right away
+	FIKBodyTickState& State = this->TickState;
+	const FVector Location = this->Body->GetComponentLocation();
+	State.CurrentLocation = FVector2f(Location.X, Location.Y);
+	State.TargetLocation = State.CurrentLocation;
+	State.PlacementTarget = State.CurrentLocation;
+	State.CurrentYaw = this->ClimbSolver.Yaw + this->BodyRotationOffset;
+	State.TargetYaw = State.CurrentYaw;
+
+	const FTransform& Head = this->GetTrackedPoses().Head;
+	State.LastCameraLocation = FVector2f(Head.GetLocation().X, Head.GetLocation().Y);
+	State.LastCameraForward = FVector3f(Head.GetRotation().GetForwardVector());
+	State.LastCameraYaw = Head.Rotator().Yaw;
+	State.CharacterState = ECharacterState::Idle;
+}
+
+void UIKBodyComponent::TickClimbing()
 {
-	this->BodyTargetRotation.Yaw = CameraTransform->GetRotation().Z + this->BodyRotationOffset;
-	this->BodyTargetLocation = CameraTransform->GetLocation() + (UKismetMathLibrary::GetRightVector(this->BodyTargetRotation) * -20);
-	this->BodyTargetLocation.Z = BodyTargetLocation.Z - this->PlayerHeight;
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_ClimbSolve);
+
+	const FIKTrackedPoses& Poses = this->GetTrackedPoses();
+	FIKClimbSolveInput Input;
+	Input.Head = Poses.Head.GetLocation();
+	Input.Anchors[0] = Poses.LeftHand.GetLocation();
+	Input.Anchors[1] = Poses.RightHand.GetLocation();
+	Input.bAnchored[0] = Poses.bLeftHandTracked && this->IsGripping(ECharacterIKHand::Left);
+	Input.bAnchored[1] = Poses.bRightHandTracked && this->IsGripping(ECharacterIKHand::Right);
+	Input.PlayerHeight = this->PlayerHeight;
+	Input.BodyOffset = this->BodyOffset;
+	Input.ArmLength = this->ClimbArmLength;
+	Input.ShoulderWidth = this->ClimbShoulderWidth;
+
+	// A climber that didn't move keeps its placement without touching the body
+	const int32 Iterations = this->ClimbSolver.Solve(Input);
+	INC_DWORD_STAT_BY(STAT_IKBody_ClimbSolveIterations, Iterations);
+	if (Iterations == 0)
+		return;
+
+	this->Body->SetWorldLocationAndRotation(this->ClimbSolver.Root, FRotator(0.0f, this->ClimbSolver.Yaw + this->BodyRotationOffset, 0.0f));
 }
 
 /*
- * Find the (shortest) angle in degrees between two transforms on the XY axis
- * Huge thanks to Eprim at https://answers.unrealengine.com/ for showing a neat trick to resolve quaternion results
+ * Sweeps the torso from the head towards the unobstructed target, stopping the body in front of whatever is in between.
+ * Then pushes it out of anything it still overlaps, such as a wall the player leans into: the sweep starts inside that wall and can't stop at it.
+ * The capsule spans the upper body only, so the floor doesn't block it.
 */
-float UIKBodyComponent::GetMovementDirection(FTransform* First, FTransform* Second)
+void UIKBodyComponent::SweepBodyPlacement(const FVector& HeadLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_PlacementSweep);
+	INC_DWORD_STAT(STAT_IKBody_PlacementSweeps);
+
+	const float HalfHeight = FMath::Max(this->PlayerHeight * 0.3f, this->PlacementRadius);
+	const float CenterZ = HeadLocation.Z - this->PlayerHeight * 0.4f;
+	const FVector Start = FVector(HeadLocation.X, HeadLocation.Y, CenterZ);
+	FVector Target = FVector(this->TickState.PlacementTarget.X, this->TickState.PlacementTarget.Y, CenterZ);
+	const FCollisionShape Torso = FCollisionShape::MakeCapsule(this->PlacementRadius, HalfHeight);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(IKBodyPlacement), false, GetOwner());
+	FHitResult Hit;
+	bool bBlocked = false;
+	if (GetWorld()->SweepSingleByChannel(Hit, Start, Target, FQuat::Identity, this->PlacementChannel, Torso, Params) && !Hit.bStartPenetrating)
+	{
+		Target = Hit.Location;
+		bBlocked = true;
+	}
+
+	// A sweep without length reports the overlap at the target and the direction out of it
+	for (int32 Iteration = 0; Iteration < 3; ++Iteration)
+	{
+		FHitResult Overlap;
+		if (!GetWorld()->SweepSingleByChannel(Overlap, Target, Target, FQuat::Identity, this->PlacementChannel, Torso, Params) || !Overlap.bStartPenetrating)
+			break;
+
+		const FVector Push = FVector(Overlap.Normal.X, Overlap.Normal.Y, 0.0f).GetSafeNormal() * (Overlap.PenetrationDepth + 0.1f);
+		if (Push.IsNearlyZero())
+			break;
+
+		Target += Push;
+		bBlocked = true;
+	}
+
+	if (bBlocked) INC_DWORD_STAT(STAT_IKBody_PlacementSweepsBlocked);
+	this->TickState.TargetLocation = FVector2f(Target.X, Target.Y);
+}
+
+void UIKBodyComponent::AppendMemoryReport(TArray<TPair<const TCHAR*, SIZE_T>>& OutParts) const
 {
-	float Rotation = 0.0f;
-	FVector Axis;
+	// Hitboxes that belong to this body: pooled ones currently on a hand and the idle pool
+	int32 NumHitboxes = this->HitboxPool.Num();
+	for (int32 Joint = 0; Joint < this->JointHitboxes.Num(); ++Joint)
+	{
+		if (this->JointHitboxes[Joint] != nullptr && this->JointHitboxPooled[Joint]) ++NumHitboxes;
+	}
 
-	// Get rotational vecotors
-	FVector FirstRotVec = First->GetRotation().Vector();
-	FVector SecondRotVec = Second->GetRotation().Vector();
+	SIZE_T LateUpdate = 0;
+	for (const TArray<int32>& Bones : this->LateUpdateBones) LateUpdate += Bones.GetAllocatedSize();
 
-	// Find quat and angle
-	const auto Quaternion = FQuat::FindBetweenNormals(FirstRotVec, SecondRotVec);
-	Quaternion.ToAxisAndAngle(Axis, Rotation);
+	SIZE_T AnimInstance = 0;
+	if (const UIKCharacterAnimInstance* Anim = this->Body != nullptr ? Cast<UIKCharacterAnimInstance>(this->Body->GetAnimInstance()) : nullptr)
+	{
+		AnimInstance = Anim->GetClass()->GetStructureSize() + Anim->GetFingerAlphasAllocatedSize();
+	}
 
-	// Convert to degrees and use axis.Z as left-right direction control to constrain angle between -180 and 180
-	return Axis.Z * FMath::RadiansToDegrees(Rotation);
+	OutParts.Emplace(TEXT("Component"), this->GetClass()->GetStructureSize());
+	OutParts.Emplace(TEXT("Finger joint tables"), this->JointTables.Fingers.GetAllocatedSize() + this->JointTables.Joints.GetAllocatedSize());
+	OutParts.Emplace(TEXT("Finger joint state"), this->JointAlphas.GetAllocatedSize() + this->JointFinished.GetAllocatedSize()
+		+ this->JointContactPending.GetAllocatedSize() + this->JointContact.GetAllocatedSize() + this->JointContactAlphas.GetAllocatedSize()
+		+ this->JointHitboxPooled.GetAllocatedSize() + this->JointHitboxes.GetAllocatedSize());
+	OutParts.Emplace(TEXT("Hitboxes"), this->HitboxPool.GetAllocatedSize() + NumHitboxes * UCapsuleComponent::StaticClass()->GetStructureSize());
+	OutParts.Emplace(TEXT("Hand input"), this->HandInputFrame.FingerCurls.GetAllocatedSize() + this->HandInputFrame.JointRotations.GetAllocatedSize());
+	OutParts.Emplace(TEXT("Grip prewarm"), this->GripPrewarm[0].Alphas.GetAllocatedSize() + this->GripPrewarm[1].Alphas.GetAllocatedSize());
+	OutParts.Emplace(TEXT("Late update"), LateUpdate);
+	OutParts.Emplace(TEXT("Pose streams"), this->PoseFrame.JointAlphas.GetAllocatedSize()
+		+ (this->PoseWriter.IsValid() ? this->PoseWriter->GetAllocatedSize() : 0)
+		+ (this->PoseReader.IsValid() ? this->PoseReader->GetAllocatedSize() : 0));
+	OutParts.Emplace(TEXT("Anim instance"), AnimInstance);
 }
 
-// Helper function that resets the Finger states of the given hand.
-void UIKBodyComponent::ResetHandFingers(ECharacterIKHand Hand)
+void UIKBodyComponent::SetPoseLeader(UIKBodyComponent* Leader)
 {
-	switch (Hand)
+	if (this->PoseLeader.Get() == Leader || this->Body == nullptr)
+		return;
+
+	// Followers skip their own animation and use the leader's bone transforms under their own root
+	this->PoseLeader = Leader;
+	this->Body->SetLeaderPoseComponent(Leader != nullptr ? Leader->Body : nullptr);
+}
+
+void UIKBodyComponent::GatherSolveInput(FIKBodySolveBatch& Batch, int32 Index) const
+{
+	const FIKBodyTickState& State = this->TickState;
+	if (this->HasTrackedInput())
 	{
-	case ECharacterIKHand::Left:
-		*FingerStates.StateMap.Find(EFingerBone::index_01_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::index_02_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::index_03_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::middle_01_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::middle_02_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::middle_03_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::ring_01_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::ring_02_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::ring_03_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::pinky_01_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::pinky_02_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::pinky_03_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::thumb_01_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::thumb_02_l) = false;
-		*FingerStates.StateMap.Find(EFingerBone::thumb_03_l) = false;
-		break;
-	case ECharacterIKHand::Right:
-		*FingerStates.StateMap.Find(EFingerBone::index_01_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::index_02_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::index_03_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::middle_01_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::middle_02_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::middle_03_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::ring_01_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::ring_02_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::ring_03_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::pinky_01_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::pinky_02_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::pinky_03_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::thumb_01_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::thumb_02_r) = false;
-		*FingerStates.StateMap.Find(EFingerBone::thumb_03_r) = false;
-		break;
+		const FTransform& CameraTransform = this->GetTrackedPoses().Head;
+		const FVector CameraLocation = CameraTransform.GetLocation();
+		const FVector Forward = CameraTransform.GetRotation().GetForwardVector();
+
+		Batch.CameraX[Index] = CameraLocation.X;
+		Batch.CameraY[Index] = CameraLocation.Y;
+		Batch.CameraZ[Index] = CameraLocation.Z;
+		Batch.ForwardX[Index] = Forward.X;
+		Batch.ForwardY[Index] = Forward.Y;
+		Batch.ForwardZ[Index] = Forward.Z;
+		Batch.CameraYaw[Index] = CameraTransform.GetRotation().Rotator().Yaw;
+	}
+	else
+	{
+		// Without input the body stays where it last stepped to
+		Batch.CameraX[Index] = State.LastCameraLocation.X;
+		Batch.CameraY[Index] = State.LastCameraLocation.Y;
+		Batch.CameraZ[Index] = 0.0f;
+		Batch.ForwardX[Index] = State.LastCameraForward.X;
+		Batch.ForwardY[Index] = State.LastCameraForward.Y;
+		Batch.ForwardZ[Index] = State.LastCameraForward.Z;
+		Batch.CameraYaw[Index] = State.LastCameraYaw;
+	}
+
+	Batch.LastX[Index] = State.LastCameraLocation.X;
+	Batch.LastY[Index] = State.LastCameraLocation.Y;
+	Batch.LastForwardX[Index] = State.LastCameraForward.X;
+	Batch.LastForwardY[Index] = State.LastCameraForward.Y;
+	Batch.LastForwardZ[Index] = State.LastCameraForward.Z;
+	Batch.LastYaw[Index] = State.LastCameraYaw;
+
+	Batch.BodyOffset[Index] = this->BodyOffset;
+	Batch.MovementThreshold[Index] = this->MovementThreshold;
+	Batch.RotationThreshold[Index] = this->RotationThreshold;
+}
+
+bool UIKBodyComponent::GetSolvedHeadLocation(FVector& OutLocation) const
+{
+	if (this->LastSolveFrame != GFrameCounter)
+		return false;
+
+	OutLocation = this->HeadTargetLocation;
+	return true;
+}
+
+void UIKBodyComponent::EnsureJointTables()
+{
+	if (this->bJointTablesBuilt)
+		return;
+
+	if (this->SkeletonProfile != nullptr)
+	{
+		this->JointTables.Build(this->SkeletonProfile->Hands);
+	}
+	else
+	{
+		TArray<FIKHandDefinition> MannequinHands;
+		UIKBodySkeletonProfile::GetMannequinHands(MannequinHands);
+		this->JointTables.Build(MannequinHands);
+	}
+
+	const int32 NumJoints = this->JointTables.Joints.Num();
+	this->JointAlphas.Init(0.0f, NumJoints);
+	this->JointFinished.Init(false, NumJoints);
+	this->JointHitboxPooled.Init(false, NumJoints);
+	this->JointHitboxes.Init(nullptr, NumJoints);
+	this->JointContactPending.Init(false, NumJoints);
+	this->JointContact.Init(false, NumJoints);
+	this->JointContactAlphas.Init(0.0f, NumJoints);
+	++this->ContactGeneration[0];
+	++this->ContactGeneration[1];
+	this->bJointTablesBuilt = true;
+
+	// Hitboxes of pawns made before the skeleton profile, matched to the joints by their mannequin bone
+	for (int32 Joint = 0; Joint < NumJoints && this->FingerHitboxes.Num() > 0; ++Joint)
+	{
+		const int8 BlendMapBone = this->JointTables.Joints[Joint].BlendMapBone;
+		if (BlendMapBone == INDEX_NONE)
+			continue;
+
+		if (UCapsuleComponent* const* Hitbox = this->FingerHitboxes.Find((EFingerBone) BlendMapBone))
+		{
+			this->JointHitboxes[Joint] = *Hitbox;
+		}
 	}
 }
 
+void UIKBodyComponent::SetSkeletonProfile(UIKBodySkeletonProfile* Profile)
+{
+	// Return pooled hitboxes before the joint layout changes
+	this->ReleaseHandHitboxes(ECharacterIKHand::Left);
+	this->ReleaseHandHitboxes(ECharacterIKHand::Right);
+
+	this->SkeletonProfile = Profile;
+	this->bJointTablesBuilt = false;
+	this->EnsureJointTables();
+}
+
+// Helper function that resets the Finger states of the given hand.
+void UIKBodyComponent::ResetHandFingers(ECharacterIKHand Hand)
+{
+	this->EnsureJointTables();
+
+	const FIKHandRange& Range = this->JointTables.Hands[(uint8) Hand];
+	this->JointFinished.SetRange(Range.FirstJoint, Range.NumJoints, false);
+
+	// Contacts still in flight were made for the previous grip
+	this->JointContactPending.SetRange(Range.FirstJoint, Range.NumJoints, false);
+	this->JointContact.SetRange(Range.FirstJoint, Range.NumJoints, false);
+	++this->ContactGeneration[(uint8) Hand];
+}
+
 void UIKBodyComponent::StartFingerIK(AActor* Target, ECharacterIKHand Hand)
 {
 	if (Target == nullptr)
@@ -228,101 +797,708 @@ void UIKBodyComponent::StartFingerIK(AActor* Target, ECharacterIKHand Hand)
 		this->ResetHandFingers(Hand);
 		break;
 	}
+
+	this->TickState.GripState |= 1 << (uint8) Hand;
+	if (!this->TickState.bHeadless || this->bKeepServerHandHitboxes) this->AcquireHandHitboxes(Hand);
+
+	// A grip prepared while approaching this target is complete in its first frame.
+	// The last prepared pose is used while the hand is still where it was measured, otherwise it is measured again from here.
+	FIKGripPrewarm& Prewarm = this->GripPrewarm[(uint8) Hand];
+	const FIKHandRange& Range = this->JointTables.Hands[(uint8) Hand];
+	if (Prewarm.Target == Target && Range.NumJoints > 0 && this->Body != nullptr)
+	{
+		if (Prewarm.Alphas.Num() != Range.NumJoints
+			|| !FVector::PointsAreNear(this->GetHandInTarget(Hand, Target), Prewarm.HandInTarget, this->GripPrewarmTolerance))
+		{
+			this->PrewarmGrip(Hand, Target);
+		}
+
+		FMemory::Memcpy(&this->JointAlphas[Range.FirstJoint], Prewarm.Alphas.GetData(), Range.NumJoints * sizeof(float));
+		this->JointFinished.SetRange(Range.FirstJoint, Range.NumJoints, true);
+		INC_DWORD_STAT(STAT_IKBody_PrewarmedGrips);
+	}
+
+	// The hitboxes belong to the grip now
+	Prewarm.Target = nullptr;
+	Prewarm.bHitboxesAcquired = false;
 }
 
-void UIKBodyComponent::StopFingerIK(ECharacterIKHand Hand)
+void UIKBodyComponent::TickGripPrewarm()
 {
-	switch (Hand)
+	UIKBodySubsystem* Subsystem = GetWorld()->GetSubsystem<UIKBodySubsystem>();
+	if (Subsystem == nullptr || Subsystem->GetGripRegistry().Num() == 0)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_GripPrewarm);
+
+	for (const ECharacterIKHand Hand : { ECharacterIKHand::Left, ECharacterIKHand::Right })
 	{
-	case ECharacterIKHand::Left:
-		this->LeftGrip = nullptr;
-		this->ResetHandFingers(Hand);
-		break;
-	case ECharacterIKHand::Right:
-		this->RightGrip = nullptr;
-		this->ResetHandFingers(Hand);
-		break;
+		// Gripping hands use the grip's hitboxes
+		if (this->IsGripping(Hand))
+			continue;
+
+		// Hands driven by hand input, or without a pose, don't need a prepared grip
+		FIKGripPrewarm& Prewarm = this->GripPrewarm[(uint8) Hand];
+		const FIKTrackedPoses& Poses = this->GetTrackedPoses();
+		const bool bHandTracked = Hand == ECharacterIKHand::Left ? Poses.bLeftHandTracked : Poses.bRightHandTracked;
+		const FTransform& HandPose = Hand == ECharacterIKHand::Left ? Poses.LeftHand : Poses.RightHand;
+		AActor* Target = this->HandInputActive[(uint8) Hand] || !bHandTracked ? nullptr 
+			: Subsystem->GetGripRegistry().FindNearest(HandPose.GetLocation(), this->GripPrewarmRadius);
+
+		if (Target == nullptr)
+		{
+			// Moved away (or the target is gone), the finger collision is only needed again once the hand approaches something
+			if (Prewarm.bHitboxesAcquired) this->ReleaseHandHitboxes(Hand);
+			Prewarm.Target = nullptr;
+			continue;
+		}
+
+		this->PrewarmGrip(Hand, Target);
 	}
 }
 
-void UIKBodyComponent::TickFingerIK(float DeltaTime)
+/*
+ * Prepares the finger collision and an estimate of the final finger pose for gripping the target.
+ * Every joint curls by its distance to the target's collision over the curl reach, instead of closing until it overlaps.
+*/
+void UIKBodyComponent::PrewarmGrip(ECharacterIKHand Hand, AActor* Target)
 {
-	for (auto& Element : FingerStates.StateMap)
+	this->EnsureJointTables();
+	this->AcquireHandHitboxes(Hand);
+
+	TInlineComponentArray<UPrimitiveComponent*> Components(Target);
+	const FIKHandRange& Range = this->JointTables.Hands[(uint8) Hand];
+	FIKGripPrewarm& Prewarm = this->GripPrewarm[(uint8) Hand];
+	Prewarm.bHitboxesAcquired = true;
+	Prewarm.Alphas.SetNumUninitialized(Range.NumJoints);
+
+	for (int32 Joint = 0; Joint < Range.NumJoints; ++Joint)
 	{
-		const EFingerBone Bone = (EFingerBone) Element.Key;
-		const bool Finished = (bool) Element.Value;
+		const FIKFingerJointInfo& Info = this->JointTables.Joints[Range.FirstJoint + Joint];
+		const UCapsuleComponent* Capsule = this->JointHitboxes[Range.FirstJoint + Joint];
+		const FVector Point = Capsule != nullptr ? Capsule->GetComponentLocation() : this->Body->GetSocketLocation(Info.Socket);
 
-		if (!Finished)
+		float Distance = MAX_flt;
+		for (const UPrimitiveComponent* Component : Components)
 		{
-			AActor* GripTarget = nullptr;
-			switch (Bone)
-			{
-			case EFingerBone::index_01_l:
-			case EFingerBone::index_02_l:
-			case EFingerBone::index_03_l:
-			case EFingerBone::middle_01_l:
-			case EFingerBone::middle_02_l:
-			case EFingerBone::middle_03_l:
-			case EFingerBone::ring_01_l:
-			case EFingerBone::ring_02_l:
-			case EFingerBone::ring_03_l:
-			case EFingerBone::pinky_01_l:
-			case EFingerBone::pinky_02_l:
-			case EFingerBone::pinky_03_l:
-			case EFingerBone::thumb_01_l:
-			case EFingerBone::thumb_02_l:
-			case EFingerBone::thumb_03_l:
-				GripTarget = LeftGrip;
-				break;
-			case EFingerBone::index_01_r:
-			case EFingerBone::index_02_r:
-			case EFingerBone::index_03_r:
-			case EFingerBone::middle_01_r:
-			case EFingerBone::middle_02_r:
-			case EFingerBone::middle_03_r:
-			case EFingerBone::ring_01_r:
-			case EFingerBone::ring_02_r:
-			case EFingerBone::ring_03_r:
-			case EFingerBone::pinky_01_r:
-			case EFingerBone::pinky_02_r:
-			case EFingerBone::pinky_03_r:
-			case EFingerBone::thumb_01_r:
-			case EFingerBone::thumb_02_r:
-			case EFingerBone::thumb_03_r:
-				GripTarget = RightGrip;
-				break;
-			}
+			FVector ClosestPoint;
+			const float ComponentDistance = Component->IsCollisionEnabled() ? Component->GetDistanceToCollision(Point, ClosestPoint) : -1.0f;
+			if (ComponentDistance >= 0.0f) Distance = FMath::Min(Distance, ComponentDistance);
+		}
 
-			float TargetAlpha = GripTarget == nullptr ? 0 : 1.0f;
-			float* CurrentAlpha = this->FingerIKValues.BlendMap.Find(Bone);
-			
-			// Check if ptr to capsule ptr is valid, and then get capsule ptr
-			UCapsuleComponent** CapsulePtrPtr = this->FingerHitboxes.Find(Bone);
-			UCapsuleComponent* Capsule = CapsulePtrPtr == nullptr ? nullptr : *CapsulePtrPtr;
-			
-			if (*CurrentAlpha == TargetAlpha)
+		Prewarm.Alphas[Joint] = FMath::Clamp(Distance / FMath::Max(this->GripCurlReach, 1.0f), 0.0f, 1.0f);
+	}
+
+	Prewarm.Target = Target;
+	Prewarm.HandInTarget = this->GetHandInTarget(Hand, Target);
+}
+
+FVector UIKBodyComponent::GetHandInTarget(ECharacterIKHand Hand, const AActor* Target) const
+{
+	const FIKTrackedPoses& Poses = this->GetTrackedPoses();
+	const FTransform& HandPose = Hand == ECharacterIKHand::Left ? Poses.LeftHand : Poses.RightHand;
+	return Target->GetActorTransform().InverseTransformPosition(HandPose.GetLocation());
+}
+
+void UIKBodyComponent::StopFingerIK(ECharacterIKHand Hand)
+{
+	switch (Hand)
+	{
+	case ECharacterIKHand::Left:
+		this->LeftGrip = nullptr;
+		this->ResetHandFingers(Hand);
+		break;
+	case ECharacterIKHand::Right:
+		this->RightGrip = nullptr;
+		this->ResetHandFingers(Hand);
+		break;
+	}
+
+	this->TickState.GripState &= ~(1 << (uint8) Hand);
+	this->ReleaseHandHitboxes(Hand);
+}
+
+void UIKBodyComponent::AcquireHandHitboxes(ECharacterIKHand Hand)
+{
+	if (this->SkeletonProfile == nullptr || this->Body == nullptr || this->GetOwner() == nullptr)
+		return;
+
+	this->EnsureJointTables();
+
+	const FIKHandRange& Range = this->JointTables.Hands[(uint8) Hand];
+	for (int32 Joint = Range.FirstJoint; Joint < Range.FirstJoint + Range.NumJoints; ++Joint)
+	{
+		const FIKFingerJointInfo& Info = this->JointTables.Joints[Joint];
+		if (!Info.bPooledHitbox || this->JointHitboxes[Joint] != nullptr)
+			continue;
+
+		// Reuse a pooled capsule, or grow the pool if both hands are already gripping
+		UCapsuleComponent* Capsule = this->HitboxPool.Num() > 0 ? this->HitboxPool.Pop(false) : nullptr;
+		if (Capsule == nullptr)
+		{
+			Capsule = NewObject<UCapsuleComponent>(this->GetOwner(), NAME_None, RF_Transient);
+			Capsule->SetCanEverAffectNavigation(false);
+			Capsule->RegisterComponent();
+		}
+
+		// Async contacts query the capsule's shape themselves, it doesn't need to update overlaps every time the bone moves
+		Capsule->SetGenerateOverlapEvents(!this->bAsyncFingerContacts);
+
+		Capsule->SetCapsuleSize(Info.HitboxRadius, Info.HitboxHalfHeight, false);
+		Capsule->SetCollisionProfileName(this->SkeletonProfile->HitboxCollisionProfileName, false);
+		Capsule->AttachToComponent(this->Body, FAttachmentTransformRules::SnapToTargetNotIncludingScale, Info.Socket);
+		Capsule->SetRelativeTransform(Info.HitboxTransform);
+		Capsule->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+
+		this->JointHitboxes[Joint] = Capsule;
+		this->JointHitboxPooled[Joint] = true;
+	}
+}
+
+void UIKBodyComponent::ReleaseHandHitboxes(ECharacterIKHand Hand)
+{
+	this->GripPrewarm[(uint8) Hand].bHitboxesAcquired = false;
+	if (!this->bJointTablesBuilt)
+		return;
+
+	const FIKHandRange& Range = this->JointTables.Hands[(uint8) Hand];
+	for (int32 Joint = Range.FirstJoint; Joint < Range.FirstJoint + Range.NumJoints; ++Joint)
+	{
+		if (!this->JointHitboxPooled[Joint])
+			continue;
+
+		// Detached capsules without collision cost nothing while the hand is idle
+		UCapsuleComponent* Capsule = this->JointHitboxes[Joint];
+		if (Capsule != nullptr)
+		{
+			Capsule->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Capsule->DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
+			this->HitboxPool.Add(Capsule);
+		}
+
+		this->JointHitboxes[Joint] = nullptr;
+		this->JointHitboxPooled[Joint] = false;
+	}
+}
+
+void UIKBodyComponent::TickFingerIK(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_TickFingerIK);
+
+	this->EnsureJointTables();
+
+	if (this->bAsyncFingerContacts && !this->FingerContactDelegate.IsBound())
+	{
+		this->FingerContactDelegate.BindUObject(this, &UIKBodyComponent::OnFingerContact);
+	}
+
+	const FCollisionQueryParams ContactParams(SCENE_QUERY_STAT(IKBodyFingerContact), false, GetOwner());
+
+	for (uint8 HandIndex = 0; HandIndex < 2; ++HandIndex)
+	{
+		// Tracked hands are driven by SampleHandInput instead
+		if (this->HandInputActive[HandIndex])
+			continue;
+
+		const FIKHandRange& Range = this->JointTables.Hands[HandIndex];
+		AActor* GripTarget = (ECharacterIKHand) HandIndex == ECharacterIKHand::Left ? LeftGrip : RightGrip;
+		const float TargetAlpha = GripTarget == nullptr ? 0 : 1.0f;
+
+		// Async contacts only look for the object types the target can be touched by
+		FCollisionObjectQueryParams ContactObjects;
+		if (this->bAsyncFingerContacts && GripTarget != nullptr)
+		{
+			TInlineComponentArray<UPrimitiveComponent*> Components(GripTarget);
+			for (const UPrimitiveComponent* Component : Components)
 			{
-				// Target is already reached since moving previous tick
-				*this->FingerStates.StateMap.Find(Bone) = true;
-				continue; // Skip to next bone
+				if (Component->IsQueryCollisionEnabled()) ContactObjects.AddObjectTypesToQuery(Component->GetCollisionObjectType());
 			}
-			
+		}
+
+		for (int32 Joint = Range.FirstJoint; Joint < Range.FirstJoint + Range.NumJoints; ++Joint)
+		{
+			if (this->JointFinished[Joint])
+				continue;
+
+			float& CurrentAlpha = this->JointAlphas[Joint];
+			UCapsuleComponent* Capsule = this->JointHitboxes[Joint];
+
+			if (this->JointContact[Joint])
+			{
+				// Touched the target when the query was made, back to the alpha the joint had then
+				CurrentAlpha = this->JointContactAlphas[Joint];
+				this->JointFinished[Joint] = true;
+				continue;
+			}
+
+			if (CurrentAlpha == TargetAlpha)
+			{
+				// Target is already reached since moving previous tick, unless a contact is still on its way
+				if (!this->JointContactPending[Joint]) this->JointFinished[Joint] = true;
+				continue; // Skip to next joint
+			}
+
 			else if (Capsule != nullptr && GripTarget != nullptr)
 			{
-				// Check if capsule is colliding with target actor since being moved previous tick
-				if (Capsule->IsOverlappingActor(GripTarget))
+				if (!this->bAsyncFingerContacts)
 				{
-					*this->FingerStates.StateMap.Find(Bone) = true;
-					continue; // Skip to next bone
+					// Check if capsule is colliding with target actor since being moved previous tick
+					if (Capsule->IsOverlappingActor(GripTarget))
+					{
+						this->JointFinished[Joint] = true;
+						continue; // Skip to next joint
+					}
+				}
+				else if (!this->JointContactPending[Joint] && ContactObjects.IsValid())
+				{
+					// Overlapped off the game thread, the result arrives before the next tick
+					const uint32 UserData = (uint32) Joint | ((uint32) this->ContactGeneration[HandIndex] << 16);
+					GetWorld()->AsyncOverlapByObjectType(Capsule->GetComponentLocation(), Capsule->GetComponentQuat(), ContactObjects,
+						Capsule->GetCollisionShape(), ContactParams, &this->FingerContactDelegate, UserData);
+
+					this->JointContactPending[Joint] = true;
+					this->JointContactAlphas[Joint] = CurrentAlpha;
+					INC_DWORD_STAT(STAT_IKBody_FingerContactQueries);
 				}
 			}
-			
+
 			// Finterp to target
-			*CurrentAlpha = UKismetMathLibrary::FInterpTo(*CurrentAlpha, TargetAlpha, DeltaTime, 4.0f);
+			CurrentAlpha = UKismetMathLibrary::FInterpTo(CurrentAlpha, TargetAlpha, DeltaTime, 4.0f);
+		}
+	}
+}
+
+void UIKBodyComponent::OnFingerContact(const FTraceHandle& Handle, FOverlapDatum& Datum)
+{
+	const int32 Joint = Datum.UserData & 0xFFFF;
+	if (!this->JointContactPending.IsValidIndex(Joint) || !this->JointContactPending[Joint])
+		return;
+
+	const uint8 HandIndex = Joint >= this->JointTables.Hands[1].FirstJoint && Joint < this->JointTables.Hands[1].FirstJoint + this->JointTables.Hands[1].NumJoints ? 1 : 0;
+	if ((uint16) (Datum.UserData >> 16) != this->ContactGeneration[HandIndex])
+		return;
+
+	this->JointContactPending[Joint] = false;
+
+	const AActor* GripTarget = HandIndex == (uint8) ECharacterIKHand::Left ? LeftGrip : RightGrip;
+	for (const FOverlapResult& Overlap : Datum.OutOverlaps)
+	{
+		if (GripTarget != nullptr && Overlap.GetActor() == GripTarget)
+		{
+			this->JointContact[Joint] = true;
+			break;
+		}
+	}
+}
+
+void UIKBodyComponent::ApplyFingerCurl(const FIKFingerRange& Finger, float Curl)
+{
+	float Alphas[UIKFingerPoseLibrary::JointsPerFinger];
+	if (this->FingerPoseLibrary != nullptr)
+	{
+		this->FingerPoseLibrary->SampleFinger(Finger.Finger, Curl, Alphas[0], Alphas[1], Alphas[2]);
+	}
+	else Alphas[0] = Alphas[1] = Alphas[2] = FMath::Clamp(Curl, 0.0f, 1.0f);
+
+	// Fingers with more or fewer joints than the library spread its three curves over their joints
+	for (int32 Joint = 0; Joint < Finger.NumJoints; ++Joint)
+	{
+		const int32 Sample = Joint * UIKFingerPoseLibrary::JointsPerFinger / Finger.NumJoints;
+		this->JointAlphas[Finger.FirstJoint + Joint] = Alphas[Sample];
+	}
+}
+
+void UIKBodyComponent::SetFingerCurl(ECharacterIKHand Hand, EIKFinger Finger, float Curl)
+{
+	this->EnsureJointTables();
+
+	const FIKHandRange& HandRange = this->JointTables.Hands[(uint8) Hand];
+	for (int32 FingerIndex = HandRange.FirstFinger; FingerIndex < HandRange.FirstFinger + HandRange.NumFingers; ++FingerIndex)
+	{
+		const FIKFingerRange& Range = this->JointTables.Fingers[FingerIndex];
+		if (Range.Finger == Finger) this->ApplyFingerCurl(Range, Curl);
+	}
+}
+
+void UIKBodyComponent::SetBodyInputSource(TScriptInterface<IIKBodyInputSource> Source)
+{
+	this->BodyInputSource = Source;
+	this->TrackedPosesFrame = MAX_uint64;
+
+	if (HasBegunPlay())
+	{
+		this->UpdateHeadless();
+		if (!this->TickState.bHeadless && this->bUseAnimationBudget && this->BudgetedBody == nullptr)
+		{
+			this->RegisterWithAnimationBudget();
+		}
+	}
+
+	// A body spawned without a camera starts once it gets its input
+	if (HasBegunPlay() && this->Body != nullptr && this->BodyIndex == INDEX_NONE && this->HasTrackedInput())
+	{
+		this->InitializeBody();
+	}
+}
+
+const FIKTrackedPoses& UIKBodyComponent::GetTrackedPoses() const
+{
+	// An input source advances its own state when sampled, so it is only sampled once per frame
+	if (IIKBodyInputSource* Source = this->BodyInputSource.GetInterface())
+	{
+		if (this->TrackedPosesFrame != GFrameCounter)
+		{
+			this->TrackedPosesFrame = GFrameCounter;
+			Source->SamplePoses(this, this->TrackedPoses);
+		}
+
+		return this->TrackedPoses;
+	}
+
+	// The camera and controllers can move during the frame, they are always read as they are now
+	if (this->Camera != nullptr) this->TrackedPoses.Head = this->Camera->GetComponentTransform();
+	if (this->LeftController != nullptr) this->TrackedPoses.LeftHand = this->LeftController->GetComponentTransform();
+	if (this->RightController != nullptr) this->TrackedPoses.RightHand = this->RightController->GetComponentTransform();
+	this->TrackedPoses.bLeftHandTracked = this->LeftController != nullptr;
+	this->TrackedPoses.bRightHandTracked = this->RightController != nullptr;
+	return this->TrackedPoses;
+}
+
+void UIKBodyComponent::SetHandInputSource(TScriptInterface<IIKHandInputSource> Source)
+{
+	this->HandInputSource = Source;
+
+	// Hands that lose their input go back to collision driven finger IK
+	if (Source.GetInterface() == nullptr)
+	{
+		for (const ECharacterIKHand Hand : { ECharacterIKHand::Left, ECharacterIKHand::Right })
+		{
+			if (this->HandInputActive[(uint8) Hand]) this->ResetHandFingers(Hand);
+			this->HandInputActive[(uint8) Hand] = false;
 		}
 	}
 }
 
+void UIKBodyComponent::SampleHandInput()
+{
+	IIKHandInputSource* Source = this->HandInputSource.GetInterface();
+	if (Source == nullptr || this->TickState.bHeadless || this->PoseReader.IsValid())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_SampleHandInput);
+	this->EnsureJointTables();
+
+	for (const ECharacterIKHand Hand : { ECharacterIKHand::Left, ECharacterIKHand::Right })
+	{
+		const bool WasActive = this->HandInputActive[(uint8) Hand];
+		const bool IsActive = Source->SampleHand(Hand, this->HandInputFrame);
+		this->HandInputActive[(uint8) Hand] = IsActive;
+
+		if (!IsActive)
+		{
+			if (WasActive) this->ResetHandFingers(Hand);
+			continue;
+		}
+
+		const FIKHandRange& HandRange = this->JointTables.Hands[(uint8) Hand];
+		const TArray<FQuat>& Rotations = this->HandInputFrame.JointRotations;
+		if (Rotations.Num() > 0)
+		{
+			// Per joint input, the joint alpha is how far the joint is rotated from its rest pose
+			const int32 NumJoints = FMath::Min(HandRange.NumJoints, Rotations.Num());
+			for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+			{
+				const float Angle = FMath::RadiansToDegrees(Rotations[Joint].GetNormalized().AngularDistance(FQuat::Identity));
+				this->JointAlphas[HandRange.FirstJoint + Joint] = FMath::Clamp(Angle / this->MaxJointCurlAngle, 0.0f, 1.0f);
+			}
+		}
+		else
+		{
+			const TArray<float>& Curls = this->HandInputFrame.FingerCurls;
+			for (int32 FingerIndex = HandRange.FirstFinger; FingerIndex < HandRange.FirstFinger + HandRange.NumFingers; ++FingerIndex)
+			{
+				const FIKFingerRange& Range = this->JointTables.Fingers[FingerIndex];
+				if (Curls.IsValidIndex((uint8) Range.Finger)) this->ApplyFingerCurl(Range, Curls[(uint8) Range.Finger]);
+			}
+		}
+
+		// Tracked joints never poll for overlaps
+		this->JointFinished.SetRange(HandRange.FirstJoint, HandRange.NumJoints, true);
+
+		// The latency is measured once the pose using this input is evaluated
+		if (this->HandInputFrame.SampleTime > 0.0)
+		{
+			const bool First = this->HandInputSampleFrame != GFrameCounter;
+			this->HandInputSampleTime = First ? this->HandInputFrame.SampleTime : FMath::Min(this->HandInputSampleTime, this->HandInputFrame.SampleTime);
+			this->HandInputSampleFrame = GFrameCounter;
+		}
+	}
+}
+
+bool UIKBodyComponent::MeasureHandInputLatency()
+{
+	if (this->HandInputSampleFrame != GFrameCounter)
+		return false;
+
+	this->HandInputLatency = (float) ((FPlatformTime::Seconds() - this->HandInputSampleTime) * 1000.0);
+	SET_FLOAT_STAT(STAT_IKBody_HandInputLatency, this->HandInputLatency);
+	return true;
+}
+
+void UIKBodyComponent::LatchTrackedPoses()
+{
+	for (int32 Target = 0; Target < NumLateUpdateTargets; ++Target)
+	{
+		const USceneComponent* Source = this->GetLateUpdateSource(Target);
+		if (Source != nullptr) this->LatchedPoses[Target] = Source->GetComponentTransform();
+	}
+
+	this->LatchFrame = GFrameCounter;
+	this->LatchTime = FPlatformTime::Seconds();
+}
+
+USceneComponent* UIKBodyComponent::GetLateUpdateSource(int32 Target) const
+{
+	// Poses of a body input source aren't tracked devices, there is nothing newer to correct with
+	if (this->BodyInputSource.GetObject() != nullptr)
+		return nullptr;
+
+	// The local HMD and controllers only track the local player's own body, remote bodies follow their replicated poses
+	const APawn* Pawn = Cast<APawn>(this->GetOwner());
+	if (Pawn == nullptr || !Pawn->IsLocallyControlled())
+		return nullptr;
+
+	switch (Target)
+	{
+	case LeftHandTarget: return this->LeftController;
+	case RightHandTarget: return this->RightController;
+	case HeadTarget: return this->Camera;
+	default: return nullptr;
+	}
+}
+
+/*
+ * Polls the tracking system for the newest pose of a late update target.
+ * Without a tracking system (or when replaying input into the components) this is the component's current transform.
+*/
+FTransform UIKBodyComponent::GetNewestTrackedPose(int32 Target) const
+{
+	USceneComponent* Source = this->GetLateUpdateSource(Target);
+	if (Source == nullptr)
+		return FTransform::Identity;
+
+	const FTransform Current = Source->GetComponentTransform();
+
+	if (Target == HeadTarget)
+	{
+		FQuat Orientation;
+		FVector Position;
+		const USceneComponent* Origin = this->Camera->GetAttachParent();
+		if (!this->Camera->bLockToHmd || Origin == nullptr || !GEngine->XRSystem.IsValid() 
+			|| !GEngine->XRSystem->GetCurrentPose(IXRTrackingSystem::HMDDeviceId, Orientation, Position))
+			return Current;
+
+		return FTransform(Orientation, Position) * Origin->GetComponentTransform();
+	}
+
+	// The controller meshes are usually attached to (or are) a motion controller component
+	UMotionControllerComponent* MotionController = Cast<UMotionControllerComponent>(Source);
+	if (MotionController == nullptr) MotionController = Cast<UMotionControllerComponent>(Source->GetAttachParent());
+
+	const USceneComponent* Origin = MotionController != nullptr ? MotionController->GetAttachParent() : nullptr;
+	if (Origin == nullptr)
+		return Current;
+
+	const float WorldToMeters = GetWorld()->GetWorldSettings()->WorldToMeters;
+	TArray<IMotionController*> MotionControllers = IModularFeatures::Get().GetModularFeatureImplementations<IMotionController>(IMotionController::GetModularFeatureName());
+	for (const IMotionController* Controller : MotionControllers)
+	{
+		FRotator Orientation;
+		FVector Position;
+		if (Controller == nullptr || !Controller->GetControllerOrientationAndPosition(MotionController->PlayerIndex, MotionController->MotionSource, Orientation, Position, WorldToMeters))
+			continue;
+
+		// Keep the source's offset from its motion controller
+		const FTransform SourceOffset = Current.GetRelativeTransform(MotionController->GetComponentTransform());
+		return SourceOffset * FTransform(Orientation, Position) * Origin->GetComponentTransform();
+	}
+
+	return Current;
+}
+
+// Caches the bone indices moved by each late update target: the target bone and everything below it
+void UIKBodyComponent::CacheLateUpdateBones()
+{
+	USkeletalMesh* Mesh = this->Body->GetSkeletalMeshAsset();
+	if (this->LateUpdateMesh == Mesh)
+		return;
+
+	this->LateUpdateMesh = Mesh;
+	const FName Bones[NumLateUpdateTargets] = { this->LeftHandBone, this->RightHandBone, this->HeadBone };
+	for (int32 Target = 0; Target < NumLateUpdateTargets; ++Target)
+	{
+		TArray<int32>& Subtree = this->LateUpdateBones[Target];
+		Subtree.Reset();
+
+		const int32 Root = Mesh != nullptr ? this->Body->GetBoneIndex(Bones[Target]) : INDEX_NONE;
+		if (Root == INDEX_NONE) continue;
+
+		// Parents always come before their children in the reference skeleton
+		const FReferenceSkeleton& RefSkeleton = Mesh->GetRefSkeleton();
+		Subtree.Add(Root);
+		for (int32 Bone = Root + 1; Bone < RefSkeleton.GetNum(); ++Bone)
+		{
+			if (Subtree.Contains(RefSkeleton.GetParentIndex(Bone))) Subtree.Add(Bone);
+		}
+	}
+}
+
+void UIKBodyComponent::ApplyLateUpdate()
+{
+	// Only correct poses the animation evaluated this frame, a skipped update would get corrected twice
+	if (!this->bLateUpdate || this->TickState.bHeadless || this->Body == nullptr || this->LatchFrame != GFrameCounter || this->PoseReader.IsValid())
+		return;
+
+	// Remote avatars would be pulled towards the local player's headset and controllers
+	const APawn* Pawn = Cast<APawn>(this->GetOwner());
+	if (Pawn == nullptr || !Pawn->IsLocallyControlled())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_LateUpdate);
+	this->CacheLateUpdateBones();
+
+	TArray<FTransform>& ComponentSpace = this->Body->GetEditableComponentSpaceTransforms();
+	ComponentSpace = this->Body->GetComponentSpaceTransforms();
+	if (ComponentSpace.Num() == 0)
+		return;
+
+	const FTransform ComponentToWorld = this->Body->GetComponentTransform();
+	const FTransform WorldToComponent = ComponentToWorld.Inverse();
+	float Correction = 0.0f;
+
+	for (int32 Target = 0; Target < NumLateUpdateTargets; ++Target)
+	{
+		if (this->LateUpdateBones[Target].Num() == 0 || this->GetLateUpdateSource(Target) == nullptr) continue;
+
+		// Move the bones along with the tracked pose, in component space
+		const FTransform Newest = this->GetNewestTrackedPose(Target);
+		const FTransform Delta = ComponentToWorld * this->LatchedPoses[Target].Inverse() * Newest * WorldToComponent;
+		for (const int32 Bone : this->LateUpdateBones[Target])
+		{
+			if (ComponentSpace.IsValidIndex(Bone)) ComponentSpace[Bone] = ComponentSpace[Bone] * Delta;
+		}
+
+		Correction = FMath::Max(Correction, (float) FVector::Distance(Newest.GetLocation(), this->LatchedPoses[Target].GetLocation()));
+		this->LatchedPoses[Target] = Newest;
+	}
+
+	this->Body->ApplyEditedComponentSpaceTransforms();
+
+	this->LateUpdateLatency = (float) ((FPlatformTime::Seconds() - this->LatchTime) * 1000.0);
+	SET_FLOAT_STAT(STAT_IKBody_LateUpdateLatency, this->LateUpdateLatency);
+	SET_FLOAT_STAT(STAT_IKBody_LateUpdateCorrection, Correction);
+
+	if (GIKBodyLateUpdateMeasure > 0)
+	{
+		UE_LOG(LogIKBodyComponent, Log, TEXT("%s late update: %.3f ms after latch, corrected %.3f cm"), *GetOwner()->GetName(), this->LateUpdateLatency, Correction);
+	}
+}
+
+static FString GetPoseStreamPath(const FString& Filename)
+{
+	return FPaths::IsRelative(Filename) ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PoseStreams"), Filename) : Filename;
+}
+
+bool UIKBodyComponent::StartPoseRecording(const FString& Filename)
+{
+	this->EnsureJointTables();
+
+	const FString Path = GetPoseStreamPath(Filename);
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(Path));
+
+	this->PoseWriter = MakeUnique<FIKPoseStreamWriter>();
+	if (!this->PoseWriter->Open(Path, this->JointTables.Joints.Num(), this->PoseRecordingFrameRate, this->PoseRecordingFramesPerChunk))
+	{
+		this->PoseWriter.Reset();
+		return false;
+	}
+
+	// Record the first frame right away
+	this->PoseRecordPendingTime = 1.0f / this->PoseRecordingFrameRate;
+	return true;
+}
+
+void UIKBodyComponent::StopPoseRecording()
+{
+	this->PoseWriter.Reset();
+}
+
+// Records frames at the stream's fixed rate, repeating the current pose if the component ticked slower than that
+void UIKBodyComponent::RecordPose(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_PoseRecording);
+
+	const float FrameTime = 1.0f / this->PoseWriter->GetFormat().FrameRate;
+	this->PoseRecordPendingTime += DeltaTime;
+	if (this->PoseRecordPendingTime < FrameTime)
+		return;
+
+	this->PoseFrame.Root = this->Body->GetComponentTransform();
+	const FIKTrackedPoses& Poses = this->GetTrackedPoses();
+	this->PoseFrame.Head = Poses.Head;
+	this->PoseFrame.LeftHand = Poses.LeftHand;
+	this->PoseFrame.RightHand = Poses.RightHand;
+	this->PoseFrame.MovementSpeed = this->MovementSpeed;
+	this->PoseFrame.MovementDirection = this->MovementDirection;
+	this->PoseFrame.JointAlphas = this->JointAlphas;
+
+	while (this->PoseRecordPendingTime >= FrameTime)
+	{
+		this->PoseWriter->AddFrame(this->PoseFrame);
+		this->PoseRecordPendingTime -= FrameTime;
+	}
+}
+
+bool UIKBodyComponent::StartPosePlayback(const FString& Filename)
+{
+	this->PoseReader = MakeUnique<FIKPoseStreamReader>();
+	if (!this->PoseReader->Open(GetPoseStreamPath(Filename)))
+	{
+		this->PoseReader.Reset();
+		return false;
+	}
+
+	this->PosePlaybackTime = 0.0f;
+	return true;
+}
+
+void UIKBodyComponent::StopPosePlayback()
+{
+	this->PoseReader.Reset();
+}
+
+// Poses the body from the stream, holding the last frame once the stream ends
+void UIKBodyComponent::TickPosePlayback(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_PosePlayback);
+
+	this->PosePlaybackTime = FMath::Min(this->PosePlaybackTime + DeltaTime, this->PoseReader->GetDuration());
+	if (!this->PoseReader->Sample(this->PosePlaybackTime, this->PoseFrame))
+		return;
+
+	if (this->Body != nullptr)
+	{
+		this->Body->SetWorldLocationAndRotation(this->PoseFrame.Root.GetLocation(), this->PoseFrame.Root.GetRotation());
+	}
+
+	this->MovementSpeed = this->PoseFrame.MovementSpeed;
+	this->MovementDirection = this->PoseFrame.MovementDirection;
+
+	this->EnsureJointTables();
+	const int32 NumJoints = FMath::Min(this->JointAlphas.Num(), this->PoseFrame.JointAlphas.Num());
+	if (NumJoints > 0) FMemory::Memcpy(this->JointAlphas.GetData(), this->PoseFrame.JointAlphas.GetData(), NumJoints * sizeof(float));
+}
+
 void UIKBodyComponent::UpdateMovementThreshold_Implementation(float Value) { this->MovementThreshold = Value; }
 
 void UIKBodyComponent::UpdateRotationThreshold_Implementation(float Value) { this->RotationThreshold = Value; }
@@ -331,6 +1507,33 @@ void UIKBodyComponent::UpdatePlayerHeight_Implementation(float Value) { this->Pl
 
 void UIKBodyComponent::UpdateBodyOffset_Implementation(float Value) { this->BodyOffset = Value; }
 
+void UIKBodyComponent::SetHitBoxes(const TArray<UCapsuleComponent*>& Hitboxes)
+{
+	this->EnsureJointTables();
+
+	for (int32 Joint = 0; Joint < this->JointHitboxes.Num(); ++Joint)
+	{
+		if (this->JointHitboxPooled[Joint])
+			continue; // Owned by the pool while the hand is gripping
+
+		this->JointHitboxes[Joint] = Hitboxes.IsValidIndex(Joint) ? Hitboxes[Joint] : nullptr;
+	}
+}
+
+void UIKBodyComponent::SetJointHitBox(FName Bone, UCapsuleComponent* Hitbox)
+{
+	this->EnsureJointTables();
+
+	const int32 Joint = this->JointTables.FindJoint(Bone);
+	if (Joint == INDEX_NONE)
+	{
+		UE_LOG(LogIKBodyComponent, Warning, TEXT("Unable to set hitbox, %s is not a joint in the skeleton profile."), *Bone.ToString());
+		return;
+	}
+
+	if (!this->JointHitboxPooled[Joint]) this->JointHitboxes[Joint] = Hitbox;
+}
+
 void UIKBodyComponent::SetAllHitBoxes(
 	UCapsuleComponent* index_01_l,
 	UCapsuleComponent* index_02_l,
@@ -364,35 +1567,21 @@ void UIKBodyComponent::SetAllHitBoxes(
 	UCapsuleComponent* thumb_03_r
 )
 {
-	this->FingerHitboxes.Empty();
-	this->FingerHitboxes.Add(EFingerBone::index_01_l, index_01_l);
-	this->FingerHitboxes.Add(EFingerBone::index_02_l, index_02_l);
-	this->FingerHitboxes.Add(EFingerBone::index_03_l, index_03_l);
-	this->FingerHitboxes.Add(EFingerBone::middle_01_l, middle_01_l);
-	this->FingerHitboxes.Add(EFingerBone::middle_02_l, middle_02_l);
-	this->FingerHitboxes.Add(EFingerBone::middle_03_l, middle_03_l);
-	this->FingerHitboxes.Add(EFingerBone::ring_01_l, ring_01_l);
-	this->FingerHitboxes.Add(EFingerBone::ring_02_l, ring_02_l);
-	this->FingerHitboxes.Add(EFingerBone::ring_03_l, ring_03_l);
-	this->FingerHitboxes.Add(EFingerBone::pinky_01_l, pinky_01_l);
-	this->FingerHitboxes.Add(EFingerBone::pinky_02_l, pinky_02_l);
-	this->FingerHitboxes.Add(EFingerBone::pinky_03_l, pinky_03_l);
-	this->FingerHitboxes.Add(EFingerBone::thumb_01_l, thumb_01_l);
-	this->FingerHitboxes.Add(EFingerBone::thumb_02_l, thumb_02_l);
-	this->FingerHitboxes.Add(EFingerBone::thumb_03_l, thumb_03_l);
-	this->FingerHitboxes.Add(EFingerBone::index_01_r, index_01_r);
-	this->FingerHitboxes.Add(EFingerBone::index_02_r, index_02_r);
-	this->FingerHitboxes.Add(EFingerBone::index_03_r, index_03_r);
-	this->FingerHitboxes.Add(EFingerBone::middle_01_r, middle_01_r);
-	this->FingerHitboxes.Add(EFingerBone::middle_02_r, middle_02_r);
-	this->FingerHitboxes.Add(EFingerBone::middle_03_r, middle_03_r);
-	this->FingerHitboxes.Add(EFingerBone::ring_01_r, ring_01_r);
-	this->FingerHitboxes.Add(EFingerBone::ring_02_r, ring_02_r);
-	this->FingerHitboxes.Add(EFingerBone::ring_03_r, ring_03_r);
-	this->FingerHitboxes.Add(EFingerBone::pinky_01_r, pinky_01_r);
-	this->FingerHitboxes.Add(EFingerBone::pinky_02_r, pinky_02_r);
-	this->FingerHitboxes.Add(EFingerBone::pinky_03_r, pinky_03_r);
-	this->FingerHitboxes.Add(EFingerBone::thumb_01_r, thumb_01_r);
-	this->FingerHitboxes.Add(EFingerBone::thumb_02_r, thumb_02_r);
-	this->FingerHitboxes.Add(EFingerBone::thumb_03_r, thumb_03_r);
-}
\ No newline at end of file
+	// Kept for existing pawns, the hitboxes are matched to the profile joints by their mannequin bone name
+	UCapsuleComponent* Hitboxes[] = {
+		index_01_l, index_02_l, index_03_l, middle_01_l, middle_02_l, middle_03_l, ring_01_l, ring_02_l, ring_03_l,
+		pinky_01_l, pinky_02_l, pinky_03_l, thumb_01_l, thumb_02_l, thumb_03_l,
+		index_01_r, index_02_r, index_03_r, middle_01_r, middle_02_r, middle_03_r, ring_01_r, ring_02_r, ring_03_r,
+		pinky_01_r, pinky_02_r, pinky_03_r, thumb_01_r, thumb_02_r, thumb_03_r
+	};
+
+	this->EnsureJointTables();
+	for (int32 Joint = 0; Joint < this->JointTables.Joints.Num(); ++Joint)
+	{
+		const int8 BlendMapBone = this->JointTables.Joints[Joint].BlendMapBone;
+		if (BlendMapBone != INDEX_NONE && !this->JointHitboxPooled[Joint])
+		{
+			this->JointHitboxes[Joint] = Hitboxes[BlendMapBone];
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Data/IKBodySkeletonProfile.h"
+
+void UIKBodySkeletonProfile::GetMannequinHands(TArray<FIKHandDefinition>& OutHands)
+{
+	static const TCHAR* FingerNames[] = { TEXT("index"), TEXT("middle"), TEXT("ring"), TEXT("pinky"), TEXT("thumb") };
+
+	OutHands.Reset(2);
+	for (const ECharacterIKHand Hand : { ECharacterIKHand::Left, ECharacterIKHand::Right })
+	{
+		FIKHandDefinition& HandDefinition = OutHands.AddDefaulted_GetRef();
+		HandDefinition.Hand = Hand;
+
+		for (int32 Finger = 0; Finger < UE_ARRAY_COUNT(FingerNames); ++Finger)
+		{
+			FIKFingerDefinition& FingerDefinition = HandDefinition.Fingers.AddDefaulted_GetRef();
+			FingerDefinition.Finger = (EIKFinger) Finger;
+
+			for (int32 Joint = 1; Joint <= 3; ++Joint)
+			{
+				FIKFingerJointDefinition& JointDefinition = FingerDefinition.Joints.AddDefaulted_GetRef();
+				JointDefinition.Bone = *FString::Printf(TEXT("%s_0%d_%s"), FingerNames[Finger], Joint, Hand == ECharacterIKHand::Left ? TEXT("l") : TEXT("r"));
+				JointDefinition.bPooledHitbox = false;
+			}
+		}
+	}
+}
+
+void FIKFingerJointTables::Build(const TArray<FIKHandDefinition>& HandDefinitions)
+{
+	const UEnum* FingerBoneEnum = StaticEnum<EFingerBone>();
+
+	this->Hands[0] = this->Hands[1] = FIKHandRange();
+	this->Fingers.Reset();
+	this->Joints.Reset();
+
+	for (const FIKHandDefinition& HandDefinition : HandDefinitions)
+	{
+		FIKHandRange& Hand = this->Hands[(uint8) HandDefinition.Hand];
+		if (Hand.NumJoints > 0) continue; // Only one definition per hand
+
+		// Joints of a hand are stored contiguously so the tick only walks a range
+		Hand.FirstFinger = this->Fingers.Num();
+		Hand.FirstJoint = this->Joints.Num();
+
+		for (const FIKFingerDefinition& FingerDefinition : HandDefinition.Fingers)
+		{
+			FIKFingerRange& Finger = this->Fingers.AddDefaulted_GetRef();
+			Finger.Finger = FingerDefinition.Finger;
+			Finger.FirstJoint = this->Joints.Num();
+			Finger.NumJoints = FingerDefinition.Joints.Num();
+
+			for (const FIKFingerJointDefinition& JointDefinition : FingerDefinition.Joints)
+			{
+				FIKFingerJointInfo& Joint = this->Joints.AddDefaulted_GetRef();
+				Joint.Bone = JointDefinition.Bone;
+				Joint.Socket = JointDefinition.Socket.IsNone() ? JointDefinition.Bone : JointDefinition.Socket;
+				Joint.HitboxTransform = JointDefinition.HitboxTransform;
+				Joint.HitboxRadius = JointDefinition.HitboxRadius;
+				Joint.HitboxHalfHeight = JointDefinition.HitboxHalfHeight;
+				Joint.bPooledHitbox = JointDefinition.bPooledHitbox;
+
+				// Mannequin bones share their name with EFingerBone, which the anim graph blend map is keyed on
+				const FString BoneName = JointDefinition.Bone.ToString();
+				for (int32 Index = 0; Index < FingerBoneEnum->NumEnums() - 1; ++Index)
+				{
+					if (FingerBoneEnum->GetNameStringByIndex(Index) == BoneName)
+					{
+						Joint.BlendMapBone = (int8) FingerBoneEnum->GetValueByIndex(Index);
+						break;
+					}
+				}
+			}
+		}
+
+		Hand.NumFingers = this->Fingers.Num() - Hand.FirstFinger;
+		Hand.NumJoints = this->Joints.Num() - Hand.FirstJoint;
+	}
+}
+
+int32 FIKFingerJointTables::FindJoint(FName Bone) const
+{
+	return this->Joints.IndexOfByPredicate([Bone](const FIKFingerJointInfo& Joint) { return Joint.Bone == Bone; });
+}
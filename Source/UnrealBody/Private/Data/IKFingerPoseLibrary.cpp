@@ -0,0 +1,113 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Data/IKFingerPoseLibrary.h"
+#include "UObject/ObjectSaveContext.h"
+
+DEFINE_LOG_CATEGORY(LogIKFingerPoseLibrary);
+
+void UIKFingerPoseLibrary::PostLoad()
+{
+	Super::PostLoad();
+
+	// Assets saved before baking existed (or with a changed sample count) are baked on load
+	if (this->BakedTable.Num() != FingersPerHand * this->SampleCount * JointsPerFinger)
+	{
+		this->Bake();
+	}
+}
+
+void UIKFingerPoseLibrary::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	// Always bake on save so the cooked asset only needs the table at runtime
+	this->Bake();
+
+	Super::PreSave(ObjectSaveContext);
+}
+
+#if WITH_EDITOR
+void UIKFingerPoseLibrary::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	this->Bake();
+}
+#endif
+
+const FIKFingerCurlCurves& UIKFingerPoseLibrary::GetCurves(EIKFinger Finger) const
+{
+	switch (Finger)
+	{
+	case EIKFinger::Middle:
+		return this->Middle;
+	case EIKFinger::Ring:
+		return this->Ring;
+	case EIKFinger::Pinky:
+		return this->Pinky;
+	case EIKFinger::Thumb:
+		return this->Thumb;
+	default:
+		return this->Index;
+	}
+}
+
+void UIKFingerPoseLibrary::Bake()
+{
+	this->SampleCount = FMath::Clamp(this->SampleCount, 2, 256);
+	this->BakedTable.SetNumUninitialized(FingersPerHand * this->SampleCount * JointsPerFinger);
+
+	for (int32 FingerIndex = 0; FingerIndex < FingersPerHand; ++FingerIndex)
+	{
+		const FIKFingerCurlCurves& Curves = this->GetCurves((EIKFinger) FingerIndex);
+		const FRichCurve* Joints[JointsPerFinger] = {
+			Curves.Proximal.GetRichCurveConst(),
+			Curves.Intermediate.GetRichCurveConst(),
+			Curves.Distal.GetRichCurveConst()
+		};
+
+		for (int32 Sample = 0; Sample < this->SampleCount; ++Sample)
+		{
+			const float Curl = (float) Sample / (float) (this->SampleCount - 1);
+			uint8* Out = &this->BakedTable[(FingerIndex * this->SampleCount + Sample) * JointsPerFinger];
+
+			for (int32 Joint = 0; Joint < JointsPerFinger; ++Joint)
+			{
+				// Curves without keys map the curl directly to the alpha
+				const float Alpha = Joints[Joint] != nullptr ? Joints[Joint]->Eval(Curl, Curl) : Curl;
+				Out[Joint] = (uint8) FMath::RoundToInt(FMath::Clamp(Alpha, 0.0f, 1.0f) * 255.0f);
+			}
+		}
+	}
+
+	UE_LOG(LogIKFingerPoseLibrary, Verbose, TEXT("Baked %s: %d samples, %d bytes for %d finger bones (both hands share the table)."),
+		*GetName(), this->SampleCount, this->GetBakedSize(), FingersPerHand * JointsPerFinger * 2);
+}
+
+void UIKFingerPoseLibrary::SampleFinger(EIKFinger Finger, float Curl, float& Proximal, float& Intermediate, float& Distal) const
+{
+	const int32 FingerIndex = (int32) Finger;
+	if (this->BakedTable.Num() != FingersPerHand * this->SampleCount * JointsPerFinger || FingerIndex >= FingersPerHand)
+	{
+		// Not baked, fall back to a linear curl
+		Proximal = Intermediate = Distal = FMath::Clamp(Curl, 0.0f, 1.0f);
+		return;
+	}
+
+	// Find the two samples surrounding the curl and blend between them
+	const float Position = FMath::Clamp(Curl, 0.0f, 1.0f) * (this->SampleCount - 1);
+	const int32 Lower = FMath::Min(FMath::FloorToInt(Position), this->SampleCount - 2);
+	const float Blend = Position - Lower;
+
+	const uint8* A = &this->BakedTable[(FingerIndex * this->SampleCount + Lower) * JointsPerFinger];
+	const uint8* B = A + JointsPerFinger;
+
+	static constexpr float Dequantize = 1.0f / 255.0f;
+	Proximal = FMath::Lerp((float) A[0], (float) B[0], Blend) * Dequantize;
+	Intermediate = FMath::Lerp((float) A[1], (float) B[1], Blend) * Dequantize;
+	Distal = FMath::Lerp((float) A[2], (float) B[2], Blend) * Dequantize;
+}
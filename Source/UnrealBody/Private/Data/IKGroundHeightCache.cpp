@@ -0,0 +1,144 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Data/IKGroundHeightCache.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+DEFINE_LOG_CATEGORY(LogIKGroundHeightCache);
+
+const FName UIKGroundHeightCache::DynamicGroundTag = "IKGround";
+
+static uint16 PackGroundNormal(const FVector& Normal)
+{
+	const uint8 X = (uint8) FMath::RoundToInt((FMath::Clamp(Normal.X, -1.0, 1.0) * 0.5 + 0.5) * 255.0);
+	const uint8 Y = (uint8) FMath::RoundToInt((FMath::Clamp(Normal.Y, -1.0, 1.0) * 0.5 + 0.5) * 255.0);
+	return (uint16) (X | (Y << 8));
+}
+
+static FVector UnpackGroundNormal(uint16 Packed)
+{
+	const float X = (float) (Packed & 0xFF) / 255.0f * 2.0f - 1.0f;
+	const float Y = (float) (Packed >> 8) / 255.0f * 2.0f - 1.0f;
+	return FVector(X, Y, FMath::Sqrt(FMath::Max(0.0f, 1.0f - X * X - Y * Y)));
+}
+
+void UIKGroundHeightCache::Bake(UWorld* World, const FBox& Bounds)
+{
+	if (World == nullptr || !Bounds.IsValid)
+		return;
+
+	this->Tiles.Reset();
+	this->BakedCellSize = FMath::Max(this->CellSize, 1.0f);
+	this->Origin = FVector2D(Bounds.Min.X, Bounds.Min.Y);
+	this->NumCellsX = FMath::CeilToInt((Bounds.Max.X - Bounds.Min.X) / this->BakedCellSize) + 1;
+	this->NumCellsY = FMath::CeilToInt((Bounds.Max.Y - Bounds.Min.Y) / this->BakedCellSize) + 1;
+
+	// Dynamic ground isn't baked, foot IK traces it live
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(IKGroundBake), true);
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (It->ActorHasTag(DynamicGroundTag)) Params.AddIgnoredActor(*It);
+	}
+
+	const FCollisionObjectQueryParams StaticObjects(ECC_WorldStatic);
+	const int32 NumTilesX = this->GetNumTilesX();
+	const int32 NumTilesY = FMath::DivideAndRoundUp(this->NumCellsY, TileCells);
+	this->Tiles.SetNum(NumTilesX * NumTilesY);
+	int32 NumGroundTiles = 0;
+
+	for (int32 TileY = 0; TileY < NumTilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < NumTilesX; ++TileX)
+		{
+			FIKGroundTile& Tile = this->Tiles[TileY * NumTilesX + TileX];
+			Tile.Heights.Init(NoGround, TileCells * TileCells);
+			Tile.Normals.Init(PackGroundNormal(FVector::UpVector), TileCells * TileCells);
+			bool HasGround = false;
+
+			for (int32 CellY = 0; CellY < TileCells; ++CellY)
+			{
+				for (int32 CellX = 0; CellX < TileCells; ++CellX)
+				{
+					const int32 X = TileX * TileCells + CellX;
+					const int32 Y = TileY * TileCells + CellY;
+					if (X >= this->NumCellsX || Y >= this->NumCellsY) continue;
+
+					const FVector2D Location = this->Origin + FVector2D((double) X, (double) Y) * this->BakedCellSize;
+					FHitResult Hit;
+					if (!World->LineTraceSingleByObjectType(Hit, FVector(Location, Bounds.Max.Z), FVector(Location, Bounds.Min.Z), StaticObjects, Params))
+						continue;
+
+					Tile.Heights[CellY * TileCells + CellX] = Hit.ImpactPoint.Z;
+					Tile.Normals[CellY * TileCells + CellX] = PackGroundNormal(Hit.ImpactNormal);
+					HasGround = true;
+				}
+			}
+
+			if (!HasGround)
+			{
+				Tile.Heights.Empty();
+				Tile.Normals.Empty();
+			}
+			else NumGroundTiles++;
+		}
+	}
+
+	UE_LOG(LogIKGroundHeightCache, Log, TEXT("Baked %s: %dx%d cells, %d of %d tiles with ground, %d bytes"), 
+		*GetName(), this->NumCellsX, this->NumCellsY, NumGroundTiles, this->Tiles.Num(), this->GetBakedSize());
+}
+
+int32 UIKGroundHeightCache::GetBakedSize() const
+{
+	int32 Size = this->Tiles.Num() * sizeof(FIKGroundTile);
+	for (const FIKGroundTile& Tile : this->Tiles)
+	{
+		Size += Tile.Heights.Num() * sizeof(float) + Tile.Normals.Num() * sizeof(uint16);
+	}
+	return Size;
+}
+
+bool UIKGroundHeightCache::GetCell(int32 X, int32 Y, float& OutHeight, FVector& OutNormal) const
+{
+	if (X < 0 || Y < 0 || X >= this->NumCellsX || Y >= this->NumCellsY)
+		return false;
+
+	const FIKGroundTile& Tile = this->Tiles[(Y / TileCells) * this->GetNumTilesX() + (X / TileCells)];
+	if (Tile.Heights.Num() == 0)
+		return false;
+
+	const int32 Cell = (Y % TileCells) * TileCells + (X % TileCells);
+	OutHeight = Tile.Heights[Cell];
+	OutNormal = UnpackGroundNormal(Tile.Normals[Cell]);
+	return OutHeight != NoGround;
+}
+
+bool UIKGroundHeightCache::Sample(const FVector& Location, float& OutHeight, FVector& OutNormal) const
+{
+	if (!this->IsBaked())
+		return false;
+
+	const float GridX = (Location.X - this->Origin.X) / this->BakedCellSize;
+	const float GridY = (Location.Y - this->Origin.Y) / this->BakedCellSize;
+	const int32 X = FMath::FloorToInt(GridX);
+	const int32 Y = FMath::FloorToInt(GridY);
+
+	// Edges of the ground (or the grid) are left to live traces
+	float Heights[4];
+	FVector Normals[4];
+	if (!this->GetCell(X, Y, Heights[0], Normals[0]) || !this->GetCell(X + 1, Y, Heights[1], Normals[1])
+		|| !this->GetCell(X, Y + 1, Heights[2], Normals[2]) || !this->GetCell(X + 1, Y + 1, Heights[3], Normals[3]))
+		return false;
+
+	const float AlphaX = GridX - X;
+	const float AlphaY = GridY - Y;
+	OutHeight = FMath::BiLerp(Heights[0], Heights[1], Heights[2], Heights[3], AlphaX, AlphaY);
+	OutNormal = FMath::BiLerp(Normals[0], Normals[1], Normals[2], Normals[3], AlphaX, AlphaY).GetSafeNormal();
+	return true;
+}
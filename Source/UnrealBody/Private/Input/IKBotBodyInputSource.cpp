@@ -0,0 +1,166 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Input/IKBotBodyInputSource.h"
+#include "CharacterComponents/IKBodyComponent.h"
+#include "UnrealBody.h"
+#include "NavigationPath.h"
+
+DECLARE_CYCLE_STAT(TEXT("Bot Driver"), STAT_IKBody_BotDriver, STATGROUP_IKBody);
+
+void UIKBotBodyInputSource::SetPath(const TArray<FVector>& Points)
+{
+	this->Path = Points;
+	this->PathPoint = 0;
+
+	// The first point is where a new bot starts, a walking bot heads to it from where it is
+	if (!this->bStarted && this->Path.Num() > 0)
+	{
+		this->Location = this->Path[0];
+		this->PathPoint = 1;
+	}
+}
+
+void UIKBotBodyInputSource::SetNavPath(UNavigationPath* NavPath)
+{
+	if (NavPath == nullptr || !NavPath->IsValid())
+		return;
+
+	this->Path = NavPath->PathPoints;
+	this->PathPoint = 0;
+}
+
+void UIKBotBodyInputSource::SetGazeTarget(FVector InLocation)
+{
+	this->GazeLocation = InLocation;
+	this->GazeActor = nullptr;
+	this->bHasGaze = true;
+}
+
+void UIKBotBodyInputSource::SetGazeActor(AActor* Actor)
+{
+	this->GazeActor = Actor;
+	this->bHasGaze = Actor != nullptr;
+}
+
+void UIKBotBodyInputSource::ClearGaze()
+{
+	this->GazeActor = nullptr;
+	this->bHasGaze = false;
+}
+
+/*
+ * Advances the bot by the world time since the last sample and builds its head and hand poses.
+ * A handful of trigonometry per bot, no traces or allocations, so the driver doesn't show up in the body's own cost.
+*/
+bool UIKBotBodyInputSource::SamplePoses(const UIKBodyComponent* Body, FIKTrackedPoses& OutPoses)
+{
+	const UWorld* World = Body != nullptr ? Body->GetWorld() : nullptr;
+	if (World == nullptr)
+		return false;
+
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_BotDriver);
+
+	const double Now = World->GetTimeSeconds();
+	if (!this->bStarted)
+	{
+		// Start where the body mesh stands, or its owner before it has one, unless a path set a start
+		const AActor* Owner = Body->GetOwner();
+		FTransform Start = FTransform::Identity;
+		if (Body->Body != nullptr) Start = Body->Body->GetComponentTransform();
+		else if (Owner != nullptr) Start = Owner->GetActorTransform();
+
+		if (this->PathPoint == 0)
+		{
+			this->Location = Start.GetLocation();
+		}
+
+		this->WalkYaw = Start.Rotator().Yaw;
+		this->HeadYaw = this->WalkYaw;
+		this->IdlePhase = FMath::FRand() * UE_TWO_PI;
+		this->LastSampleTime = Now;
+		this->bStarted = true;
+	}
+
+	const float DeltaTime = FMath::Min((float) (Now - this->LastSampleTime), 0.1f);
+	this->LastSampleTime = Now;
+	const float Time = (float) Now + this->IdlePhase;
+
+	// Walk along the path, possibly past several points in a long frame
+	float Walked = 0.0f;
+	float TargetWalkYaw = this->WalkYaw;
+	if (this->PathPoint < this->Path.Num())
+	{
+		float Remaining = this->WalkSpeed * DeltaTime;
+		while (Remaining > 0.0f && this->PathPoint < this->Path.Num())
+		{
+			const FVector ToPoint = this->Path[this->PathPoint] - this->Location;
+			const float Distance = ToPoint.Size();
+			if (Distance <= Remaining)
+			{
+				this->Location = this->Path[this->PathPoint++];
+				Walked += Distance;
+				Remaining -= Distance;
+			}
+			else
+			{
+				this->Location += ToPoint * (Remaining / Distance);
+				Walked += Remaining;
+				Remaining = 0.0f;
+			}
+		}
+
+		if (this->PathPoint < this->Path.Num())
+		{
+			TargetWalkYaw = (this->Path[this->PathPoint] - this->Location).Rotation().Yaw;
+		}
+	}
+
+	this->WalkYaw = FMath::FixedTurn(this->WalkYaw, TargetWalkYaw, this->TurnRate * DeltaTime);
+	this->StridePhase = FMath::Fmod(this->StridePhase + Walked / FMath::Max(this->StrideLength, 1.0f) * UE_PI, UE_TWO_PI);
+	const float WalkAlpha = DeltaTime > 0.0f ? FMath::Min(Walked / (DeltaTime * FMath::Max(this->WalkSpeed, 1.0f)), 1.0f) : 0.0f;
+
+	// Look at the gaze target within the head's reach, or look around
+	const FVector Eyes = this->Location + FVector(0.0f, 0.0f, this->EyeHeight);
+	float TargetHeadYaw = this->WalkYaw + FMath::Sin(Time * 0.3f) * 25.0f;
+	float TargetHeadPitch = -5.0f + FMath::Sin(Time * 0.5f) * 5.0f;
+	if (this->bHasGaze)
+	{
+		const AActor* Actor = this->GazeActor.Get();
+		if (Actor != nullptr || this->GazeActor.IsExplicitlyNull())
+		{
+			const FRotator Gaze = ((Actor != nullptr ? Actor->GetActorLocation() : this->GazeLocation) - Eyes).Rotation();
+			TargetHeadYaw = this->WalkYaw + FMath::Clamp(FRotator::NormalizeAxis(Gaze.Yaw - this->WalkYaw), -this->MaxHeadYaw, this->MaxHeadYaw);
+			TargetHeadPitch = FMath::Clamp(Gaze.Pitch, -45.0f, 45.0f);
+		}
+	}
+
+	this->HeadYaw = FMath::FixedTurn(this->HeadYaw, TargetHeadYaw, this->TurnRate * DeltaTime);
+	this->HeadPitch = FMath::FInterpTo(this->HeadPitch, TargetHeadPitch, DeltaTime, 4.0f);
+
+	// Bob twice per stride, sway a little when standing
+	const float Step = FMath::Sin(this->StridePhase);
+	const float Bob = (FMath::Abs(Step) - 1.0f) * this->HeadBob * WalkAlpha;
+	const FRotator WalkRotation = FRotator(0.0f, this->WalkYaw, 0.0f);
+	const FVector Sway = WalkRotation.RotateVector(FVector(0.0f, FMath::Sin(Time * 1.1f) * 1.5f, FMath::Sin(Time * 0.7f) * 0.5f));
+
+	OutPoses.Head = FTransform(FRotator(this->HeadPitch, this->HeadYaw, Step * 2.0f * WalkAlpha), Eyes + Sway + FVector(0.0f, 0.0f, Bob));
+
+	// Hands in front of the hips as players hold controllers, swinging opposite to each other
+	const float Swing = Step * this->HandSwing * WalkAlpha;
+	const float HandHeight = this->EyeHeight * 0.6f;
+	OutPoses.LeftHand = FTransform(FRotator(-20.0f, this->WalkYaw + 10.0f, -10.0f),
+		this->Location + WalkRotation.RotateVector(FVector(25.0f + Swing, -22.0f, HandHeight)) + Sway);
+	OutPoses.RightHand = FTransform(FRotator(-20.0f, this->WalkYaw - 10.0f, 10.0f),
+		this->Location + WalkRotation.RotateVector(FVector(25.0f - Swing, 22.0f, HandHeight)) + Sway);
+	OutPoses.bLeftHandTracked = true;
+	OutPoses.bRightHandTracked = true;
+
+	return true;
+}
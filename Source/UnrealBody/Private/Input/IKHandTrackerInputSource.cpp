@@ -0,0 +1,58 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Input/IKHandTrackerInputSource.h"
+#include "Features/IModularFeatures.h"
+#include "IHandTracker.h"
+
+bool UIKHandTrackerInputSource::SampleHand(ECharacterIKHand Hand, FIKHandInputFrame& OutFrame)
+{
+	IModularFeatures& Features = IModularFeatures::Get();
+	if (!Features.IsModularFeatureAvailable(IHandTracker::GetModularFeatureName()))
+		return false;
+
+	IHandTracker& Tracker = Features.GetModularFeature<IHandTracker>(IHandTracker::GetModularFeatureName());
+	if (!Tracker.IsHandTrackingStateValid())
+		return false;
+
+	const EControllerHand ControllerHand = Hand == ECharacterIKHand::Left ? EControllerHand::Left : EControllerHand::Right;
+
+	// Base (metacarpal, proximal) and tip (distal, tip) keypoints per finger, in EIKFinger order
+	static const EHandKeypoint Keypoints[5][4] = {
+		{ EHandKeypoint::IndexMetacarpal, EHandKeypoint::IndexProximal, EHandKeypoint::IndexDistal, EHandKeypoint::IndexTip },
+		{ EHandKeypoint::MiddleMetacarpal, EHandKeypoint::MiddleProximal, EHandKeypoint::MiddleDistal, EHandKeypoint::MiddleTip },
+		{ EHandKeypoint::RingMetacarpal, EHandKeypoint::RingProximal, EHandKeypoint::RingDistal, EHandKeypoint::RingTip },
+		{ EHandKeypoint::LittleMetacarpal, EHandKeypoint::LittleProximal, EHandKeypoint::LittleDistal, EHandKeypoint::LittleTip },
+		{ EHandKeypoint::ThumbMetacarpal, EHandKeypoint::ThumbProximal, EHandKeypoint::ThumbDistal, EHandKeypoint::ThumbTip }
+	};
+
+	OutFrame.JointRotations.Reset();
+	OutFrame.FingerCurls.SetNumUninitialized(UE_ARRAY_COUNT(Keypoints));
+
+	// IHandTracker has no pose timestamps, the latency counts from reading the keypoints to the evaluated pose
+	OutFrame.SampleTime = FPlatformTime::Seconds();
+
+	for (int32 Finger = 0; Finger < UE_ARRAY_COUNT(Keypoints); ++Finger)
+	{
+		FTransform Points[4];
+		float Radius = 0.0f;
+		for (int32 Point = 0; Point < 4; ++Point)
+		{
+			if (!Tracker.GetKeypointState(ControllerHand, Keypoints[Finger][Point], Points[Point], Radius))
+				return false;
+		}
+
+		const FVector Base = (Points[1].GetLocation() - Points[0].GetLocation()).GetSafeNormal();
+		const FVector Tip = (Points[3].GetLocation() - Points[2].GetLocation()).GetSafeNormal();
+		const float Angle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(Base | Tip, -1.0f, 1.0f)));
+		OutFrame.FingerCurls[Finger] = FMath::Clamp(Angle / this->FullCurlAngle, 0.0f, 1.0f);
+	}
+
+	return true;
+}
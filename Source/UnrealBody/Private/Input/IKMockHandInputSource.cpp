@@ -0,0 +1,42 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Input/IKMockHandInputSource.h"
+
+void UIKMockHandInputSource::SetFingerCurls(ECharacterIKHand Hand, const TArray<float>& Curls)
+{
+	FIKHandInputFrame& Frame = this->Frames[(uint8) Hand];
+	Frame.FingerCurls = Curls;
+	Frame.JointRotations.Reset();
+	Frame.SampleTime = FPlatformTime::Seconds();
+	this->HasInput[(uint8) Hand] = true;
+}
+
+void UIKMockHandInputSource::SetJointRotations(ECharacterIKHand Hand, const TArray<FQuat>& Rotations)
+{
+	FIKHandInputFrame& Frame = this->Frames[(uint8) Hand];
+	Frame.JointRotations = Rotations;
+	Frame.FingerCurls.Reset();
+	Frame.SampleTime = FPlatformTime::Seconds();
+	this->HasInput[(uint8) Hand] = true;
+}
+
+void UIKMockHandInputSource::ClearHand(ECharacterIKHand Hand)
+{
+	this->HasInput[(uint8) Hand] = false;
+}
+
+bool UIKMockHandInputSource::SampleHand(ECharacterIKHand Hand, FIKHandInputFrame& OutFrame)
+{
+	if (!this->HasInput[(uint8) Hand])
+		return false;
+
+	OutFrame = this->Frames[(uint8) Hand];
+	return true;
+}
@@ -0,0 +1,487 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Replay/IKPoseStream.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY(LogIKPoseStream);
+
+namespace IKPoseStream
+{
+	template<typename T>
+	void Write(TArray<uint8>& Out, T Value)
+	{
+		Out.Append((const uint8*) &Value, sizeof(T));
+	}
+
+	template<typename T>
+	T Read(const uint8*& In)
+	{
+		T Value;
+		FMemory::Memcpy(&Value, In, sizeof(T));
+		In += sizeof(T);
+		return Value;
+	}
+
+	int16 Quantize(float Value, float Scale)
+	{
+		return (int16) FMath::Clamp(FMath::RoundToInt(Value * Scale), -MAX_int16, MAX_int16);
+	}
+
+	// Rotations are stored as X, Y and Z of the quaternion with a positive W
+	void WriteRotation(TArray<uint8>& Out, FQuat Rotation)
+	{
+		Rotation.Normalize();
+		if (Rotation.W < 0.0) Rotation = -Rotation;
+		Write(Out, Quantize(Rotation.X, MAX_int16));
+		Write(Out, Quantize(Rotation.Y, MAX_int16));
+		Write(Out, Quantize(Rotation.Z, MAX_int16));
+	}
+
+	FQuat ReadRotation(const uint8*& In)
+	{
+		const double X = Read<int16>(In) / (double) MAX_int16;
+		const double Y = Read<int16>(In) / (double) MAX_int16;
+		const double Z = Read<int16>(In) / (double) MAX_int16;
+		return FQuat(X, Y, Z, FMath::Sqrt(FMath::Max(0.0, 1.0 - X * X - Y * Y - Z * Z))).GetNormalized();
+	}
+
+	void GetTransforms(const FIKPoseFrame& Frame, const FTransform* (&Out)[FIKPoseStreamFormat::NumTransforms])
+	{
+		Out[0] = &Frame.Root;
+		Out[1] = &Frame.Head;
+		Out[2] = &Frame.LeftHand;
+		Out[3] = &Frame.RightHand;
+	}
+
+	void GetTransforms(FIKPoseFrame& Frame, FTransform* (&Out)[FIKPoseStreamFormat::NumTransforms])
+	{
+		Out[0] = &Frame.Root;
+		Out[1] = &Frame.Head;
+		Out[2] = &Frame.LeftHand;
+		Out[3] = &Frame.RightHand;
+	}
+}
+
+void FIKPoseFrame::Blend(const FIKPoseFrame& A, const FIKPoseFrame& B, float Alpha, FIKPoseFrame& Out)
+{
+	Out.Root.Blend(A.Root, B.Root, Alpha);
+	Out.Head.Blend(A.Head, B.Head, Alpha);
+	Out.LeftHand.Blend(A.LeftHand, B.LeftHand, Alpha);
+	Out.RightHand.Blend(A.RightHand, B.RightHand, Alpha);
+	Out.MovementSpeed = FMath::Lerp(A.MovementSpeed, B.MovementSpeed, Alpha);
+	Out.MovementDirection = FMath::Lerp(A.MovementDirection, B.MovementDirection, Alpha);
+
+	Out.JointAlphas.SetNumUninitialized(FMath::Min(A.JointAlphas.Num(), B.JointAlphas.Num()));
+	for (int32 Joint = 0; Joint < Out.JointAlphas.Num(); ++Joint)
+	{
+		Out.JointAlphas[Joint] = FMath::Lerp(A.JointAlphas[Joint], B.JointAlphas[Joint], Alpha);
+	}
+}
+
+bool FIKPoseStreamWriter::Open(const FString& InFilename, int32 NumJoints, float FrameRate, int32 FramesPerChunk)
+{
+	this->Close();
+
+	this->File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*InFilename));
+	if (!this->File.IsValid())
+	{
+		UE_LOG(LogIKPoseStream, Warning, TEXT("Unable to open %s for writing."), *InFilename);
+		return false;
+	}
+
+	this->Filename = InFilename;
+	this->Format = FIKPoseStreamFormat();
+	this->Format.FrameRate = FMath::Max(FrameRate, 1.0f);
+	this->Format.FramesPerChunk = FMath::Max(FramesPerChunk, 1);
+	this->Format.NumJoints = NumJoints;
+	this->Chunk.Reset(this->Format.GetChunkSize());
+	this->ChunkFrames = 0;
+	this->EncodeSeconds = 0.0;
+
+	this->WriteHeader();
+	return true;
+}
+
+void FIKPoseStreamWriter::WriteHeader()
+{
+	TArray<uint8> Header;
+	IKPoseStream::Write(Header, FIKPoseStreamFormat::Magic);
+	IKPoseStream::Write(Header, FIKPoseStreamFormat::Version);
+	IKPoseStream::Write(Header, this->Format.FrameRate);
+	IKPoseStream::Write(Header, this->Format.FramesPerChunk);
+	IKPoseStream::Write(Header, this->Format.NumJoints);
+	IKPoseStream::Write(Header, this->Format.NumFrames);
+	check(Header.Num() == FIKPoseStreamFormat::HeaderSize);
+
+	this->File->Seek(0);
+	this->File->Write(Header.GetData(), Header.Num());
+}
+
+void FIKPoseStreamWriter::AddFrame(const FIKPoseFrame& Frame)
+{
+	if (!this->File.IsValid())
+		return;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FTransform* Transforms[FIKPoseStreamFormat::NumTransforms];
+	IKPoseStream::GetTransforms(Frame, Transforms);
+
+	if (this->ChunkFrames == 0)
+	{
+		// Keyframe, frame count is filled in when the chunk is flushed
+		IKPoseStream::Write(this->Chunk, (int32) 0);
+		for (int32 Index = 0; Index < FIKPoseStreamFormat::NumTransforms; ++Index)
+		{
+			const FVector Location = Transforms[Index]->GetLocation();
+			IKPoseStream::Write(this->Chunk, Location.X);
+			IKPoseStream::Write(this->Chunk, Location.Y);
+			IKPoseStream::Write(this->Chunk, Location.Z);
+			this->Decoded[Index] = Location;
+		}
+	}
+	else
+	{
+		for (int32 Index = 0; Index < FIKPoseStreamFormat::NumTransforms; ++Index)
+		{
+			const FVector Delta = Transforms[Index]->GetLocation() - this->Decoded[Index];
+			const int16 Quantized[3] = {
+				IKPoseStream::Quantize(Delta.X, 1.0f / FIKPoseStreamFormat::PositionStep),
+				IKPoseStream::Quantize(Delta.Y, 1.0f / FIKPoseStreamFormat::PositionStep),
+				IKPoseStream::Quantize(Delta.Z, 1.0f / FIKPoseStreamFormat::PositionStep)
+			};
+
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				IKPoseStream::Write(this->Chunk, Quantized[Axis]);
+				this->Decoded[Index][Axis] += Quantized[Axis] * FIKPoseStreamFormat::PositionStep;
+			}
+		}
+	}
+
+	for (int32 Index = 0; Index < FIKPoseStreamFormat::NumTransforms; ++Index)
+	{
+		IKPoseStream::WriteRotation(this->Chunk, Transforms[Index]->GetRotation());
+	}
+
+	IKPoseStream::Write(this->Chunk, IKPoseStream::Quantize(Frame.MovementSpeed, 100.0f));
+	IKPoseStream::Write(this->Chunk, IKPoseStream::Quantize(Frame.MovementDirection, 10.0f));
+
+	for (int32 Joint = 0; Joint < this->Format.NumJoints; ++Joint)
+	{
+		const float Alpha = Frame.JointAlphas.IsValidIndex(Joint) ? Frame.JointAlphas[Joint] : 0.0f;
+		IKPoseStream::Write(this->Chunk, (uint8) FMath::RoundToInt(FMath::Clamp(Alpha, 0.0f, 1.0f) * 255.0f));
+	}
+
+	this->Format.NumFrames++;
+	if (++this->ChunkFrames == this->Format.FramesPerChunk)
+	{
+		this->FlushChunk();
+	}
+
+	this->EncodeSeconds += FPlatformTime::Seconds() - StartTime;
+}
+
+void FIKPoseStreamWriter::FlushChunk()
+{
+	if (this->ChunkFrames == 0)
+		return;
+
+	// Partial chunks are padded, every chunk has the same size
+	FMemory::Memcpy(this->Chunk.GetData(), &this->ChunkFrames, sizeof(int32));
+	this->Chunk.SetNumZeroed(this->Format.GetChunkSize());
+
+	this->File->Write(this->Chunk.GetData(), this->Chunk.Num());
+	this->Chunk.Reset();
+	this->ChunkFrames = 0;
+}
+
+void FIKPoseStreamWriter::Close()
+{
+	if (!this->File.IsValid())
+		return;
+
+	this->FlushChunk();
+	this->WriteHeader();
+	const int64 Bytes = this->File->Size();
+	this->File.Reset();
+
+	const float Minutes = this->Format.NumFrames / this->Format.FrameRate / 60.0f;
+	UE_LOG(LogIKPoseStream, Log, TEXT("Recorded %s: %d frames, %lld bytes (%.1f KB per minute), encoded at %.0f frames per second"), 
+		*this->Filename, this->Format.NumFrames, Bytes, 
+		Minutes > 0.0f ? Bytes / 1024.0f / Minutes : 0.0f, 
+		this->EncodeSeconds > 0.0 ? this->Format.NumFrames / this->EncodeSeconds : 0.0);
+}
+
+bool FIKPoseStreamReader::Open(const FString& Filename)
+{
+	this->Close();
+
+	this->MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (!this->MappedFile.IsValid() || this->MappedFile->GetFileSize() < FIKPoseStreamFormat::HeaderSize)
+	{
+		UE_LOG(LogIKPoseStream, Warning, TEXT("Unable to map %s."), *Filename);
+		this->Close();
+		return false;
+	}
+
+	this->MappedRegion.Reset(this->MappedFile->MapRegion());
+	this->Data = this->MappedRegion.IsValid() ? this->MappedRegion->GetMappedPtr() : nullptr;
+	this->Size = this->MappedRegion.IsValid() ? this->MappedRegion->GetMappedSize() : 0;
+
+	const uint8* Header = this->Data;
+	if (Header == nullptr || IKPoseStream::Read<uint32>(Header) != FIKPoseStreamFormat::Magic || IKPoseStream::Read<uint32>(Header) != FIKPoseStreamFormat::Version)
+	{
+		UE_LOG(LogIKPoseStream, Warning, TEXT("%s is not a pose stream, or was written by another version."), *Filename);
+		this->Close();
+		return false;
+	}
+
+	this->Format.FrameRate = IKPoseStream::Read<float>(Header);
+	this->Format.FramesPerChunk = IKPoseStream::Read<int32>(Header);
+	this->Format.NumJoints = IKPoseStream::Read<int32>(Header);
+	this->Format.NumFrames = IKPoseStream::Read<int32>(Header);
+
+	// Don't trust a header the chunks don't fit in
+	const int64 NumChunks = FMath::DivideAndRoundUp(this->Format.NumFrames, this->Format.FramesPerChunk);
+	if (this->Format.FrameRate <= 0.0f || this->Format.FramesPerChunk <= 0 || this->Format.NumJoints < 0
+		|| FIKPoseStreamFormat::HeaderSize + NumChunks * this->Format.GetChunkSize() > this->Size)
+	{
+		UE_LOG(LogIKPoseStream, Warning, TEXT("%s is truncated."), *Filename);
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FIKPoseStreamReader::Close()
+{
+	this->Data = nullptr;
+	this->Size = 0;
+	this->MappedRegion.Reset();
+	this->MappedFile.Reset();
+	this->Format = FIKPoseStreamFormat();
+}
+
+bool FIKPoseStreamReader::ReadFrame(int32 Frame, FIKPoseFrame& Out) const
+{
+	if (this->Data == nullptr || Frame < 0 || Frame >= this->Format.NumFrames)
+		return false;
+
+	const int32 ChunkIndex = Frame / this->Format.FramesPerChunk;
+	const int32 FrameInChunk = Frame % this->Format.FramesPerChunk;
+	const uint8* Keyframe = this->Data + FIKPoseStreamFormat::HeaderSize + (int64) ChunkIndex * this->Format.GetChunkSize() + sizeof(int32);
+
+	// Keyframe positions
+	const uint8* In = Keyframe;
+	FVector Locations[FIKPoseStreamFormat::NumTransforms];
+	for (int32 Index = 0; Index < FIKPoseStreamFormat::NumTransforms; ++Index)
+	{
+		Locations[Index].X = IKPoseStream::Read<double>(In);
+		Locations[Index].Y = IKPoseStream::Read<double>(In);
+		Locations[Index].Z = IKPoseStream::Read<double>(In);
+	}
+
+	// Add up the position deltas of the frames up to the requested one
+	const uint8* DeltaFrame = Keyframe + this->Format.GetKeyframeSize();
+	for (int32 Step = 1; Step <= FrameInChunk; ++Step)
+	{
+		In = DeltaFrame;
+		for (int32 Index = 0; Index < FIKPoseStreamFormat::NumTransforms; ++Index)
+		{
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				Locations[Index][Axis] += IKPoseStream::Read<int16>(In) * FIKPoseStreamFormat::PositionStep;
+			}
+		}
+
+		if (Step < FrameInChunk) DeltaFrame += this->Format.GetDeltaFrameSize();
+	}
+
+	// Rotations, movement and joint alphas of the requested frame follow its positions
+	FTransform* Transforms[FIKPoseStreamFormat::NumTransforms];
+	IKPoseStream::GetTransforms(Out, Transforms);
+	for (int32 Index = 0; Index < FIKPoseStreamFormat::NumTransforms; ++Index)
+	{
+		*Transforms[Index] = FTransform(IKPoseStream::ReadRotation(In), Locations[Index]);
+	}
+
+	Out.MovementSpeed = IKPoseStream::Read<int16>(In) / 100.0f;
+	Out.MovementDirection = IKPoseStream::Read<int16>(In) / 10.0f;
+
+	Out.JointAlphas.SetNumUninitialized(this->Format.NumJoints);
+	for (int32 Joint = 0; Joint < this->Format.NumJoints; ++Joint)
+	{
+		Out.JointAlphas[Joint] = IKPoseStream::Read<uint8>(In) / 255.0f;
+	}
+
+	return true;
+}
+
+bool FIKPoseStreamReader::Sample(float Time, FIKPoseFrame& Out) const
+{
+	if (this->Data == nullptr || this->Format.NumFrames == 0)
+		return false;
+
+	const float FrameTime = FMath::Clamp(Time * this->Format.FrameRate, 0.0f, (float) (this->Format.NumFrames - 1));
+	const int32 Frame = FMath::FloorToInt(FrameTime);
+	const float Alpha = FrameTime - Frame;
+
+	if (!this->ReadFrame(Frame, Out))
+		return false;
+
+	if (Alpha > 0.0f && this->ReadFrame(Frame + 1, this->NextFrame))
+	{
+		FIKPoseFrame::Blend(Out, this->NextFrame, Alpha, Out);
+	}
+
+	return true;
+}
+
+/*
+ * Records synthetic avatars walking around with swinging hands and curling fingers, then plays them back.
+ * Logs the encode and decode rate, the time to seek to a keyframe and to the last frame of a chunk, and the bytes per avatar-minute.
+*/
+static void IKPoseStreamBenchmark(const TArray<FString>& Args)
+{
+	const int32 NumAvatars = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 16;
+	const float Seconds = Args.Num() > 1 ? FMath::Max(1.0f, FCString::Atof(*Args[1])) : 60.0f;
+	const int32 FramesPerChunk = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 30;
+	const float FrameRate = 30.0f;
+	const int32 NumJoints = 30;
+	const int32 NumFrames = FMath::CeilToInt(Seconds * FrameRate);
+
+	const FString Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("PoseStreams"), TEXT("Benchmark"));
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+
+	TArray<FString> Filenames;
+	TArray<TUniquePtr<FIKPoseStreamWriter>> Writers;
+	for (int32 Avatar = 0; Avatar < NumAvatars; ++Avatar)
+	{
+		Filenames.Add(FPaths::Combine(Directory, FString::Printf(TEXT("Avatar%d.ikpose"), Avatar)));
+		Writers.Add(MakeUnique<FIKPoseStreamWriter>());
+		if (!Writers.Last()->Open(Filenames.Last(), NumJoints, FrameRate, FramesPerChunk))
+		{
+			Writers.Empty();
+			IFileManager::Get().DeleteDirectory(*Directory, false, true);
+			return;
+		}
+	}
+
+	// Avatars are recorded frame by frame as they would be in game, each walking a circle of its own
+	FIKPoseFrame Frame;
+	Frame.JointAlphas.SetNumZeroed(NumJoints);
+	double EncodeSeconds = 0.0;
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		const float Time = FrameIndex / FrameRate;
+		for (int32 Avatar = 0; Avatar < NumAvatars; ++Avatar)
+		{
+			const float Angle = Time * 0.3f + Avatar;
+			const FVector Center(Avatar * 500.0f, 0.0f, 0.0f);
+			const FQuat Facing(FVector::UpVector, Angle + HALF_PI);
+			const float Swing = FMath::Sin(Time * 6.0f + Avatar) * 20.0f;
+
+			Frame.Root = FTransform(Facing, Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * 300.0f);
+			Frame.Head = FTransform(Facing * FQuat(FVector::RightVector, FMath::Sin(Time) * 0.2f), Frame.Root.TransformPosition(FVector(0.0f, 0.0f, 170.0f + FMath::Sin(Time * 12.0f) * 2.0f)));
+			Frame.LeftHand = FTransform(Facing, Frame.Root.TransformPosition(FVector(Swing, -25.0f, 100.0f)));
+			Frame.RightHand = FTransform(Facing, Frame.Root.TransformPosition(FVector(-Swing, 25.0f, 100.0f)));
+			Frame.MovementSpeed = 90.0f;
+			Frame.MovementDirection = 0.0f;
+			for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+			{
+				Frame.JointAlphas[Joint] = FMath::Sin(Time * 2.0f + Joint * 0.1f + Avatar) * 0.5f + 0.5f;
+			}
+
+			const double Start = FPlatformTime::Seconds();
+			Writers[Avatar]->AddFrame(Frame);
+			EncodeSeconds += FPlatformTime::Seconds() - Start;
+		}
+	}
+	Writers.Empty();
+
+	int64 Bytes = 0;
+	TArray<FIKPoseStreamReader> Readers;
+	Readers.SetNum(NumAvatars);
+	for (int32 Avatar = 0; Avatar < NumAvatars; ++Avatar)
+	{
+		Bytes += IFileManager::Get().FileSize(*Filenames[Avatar]);
+		if (!Readers[Avatar].Open(Filenames[Avatar]))
+		{
+			Readers.Empty();
+			IFileManager::Get().DeleteDirectory(*Directory, false, true);
+			return;
+		}
+	}
+
+	// Seeks land in chunks in random order, once on their keyframe and once on their last frame, which adds up every delta
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumFrames, FramesPerChunk);
+	TArray<int32> Chunks;
+	for (int32 Chunk = 0; Chunk < NumChunks; ++Chunk)
+	{
+		Chunks.Add(Chunk);
+	}
+	FRandomStream Random(NumAvatars);
+	for (int32 Index = Chunks.Num() - 1; Index > 0; --Index)
+	{
+		Chunks.Swap(Index, Random.RandRange(0, Index));
+	}
+
+	double Start = FPlatformTime::Seconds();
+	for (const FIKPoseStreamReader& Reader : Readers)
+	{
+		for (int32 Chunk : Chunks)
+		{
+			Reader.ReadFrame(Chunk * FramesPerChunk, Frame);
+		}
+	}
+	const double KeyframeSeekSeconds = FPlatformTime::Seconds() - Start;
+
+	Start = FPlatformTime::Seconds();
+	for (const FIKPoseStreamReader& Reader : Readers)
+	{
+		for (int32 Chunk : Chunks)
+		{
+			Reader.ReadFrame(FMath::Min((Chunk + 1) * FramesPerChunk, NumFrames) - 1, Frame);
+		}
+	}
+	const double ChunkEndSeekSeconds = FPlatformTime::Seconds() - Start;
+
+	// Playback decodes every frame in order
+	Start = FPlatformTime::Seconds();
+	for (const FIKPoseStreamReader& Reader : Readers)
+	{
+		for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+		{
+			Reader.ReadFrame(FrameIndex, Frame);
+		}
+	}
+	const double DecodeSeconds = FPlatformTime::Seconds() - Start;
+
+	Readers.Empty();
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+	const int64 TotalFrames = (int64) NumFrames * NumAvatars;
+	const int64 TotalSeeks = (int64) NumChunks * NumAvatars;
+	UE_LOG(LogIKPoseStream, Display, TEXT("%d avatars, %.0f s at %.0f fps, %d frames per chunk: encode %.0f frames per second, decode %.0f frames per second, seek %.2f us to a keyframe, %.2f us to the end of a chunk, %.1f KB per avatar-minute"),
+		NumAvatars, Seconds, FrameRate, FramesPerChunk,
+		EncodeSeconds > 0.0 ? TotalFrames / EncodeSeconds : 0.0,
+		DecodeSeconds > 0.0 ? TotalFrames / DecodeSeconds : 0.0,
+		KeyframeSeekSeconds * 1e6 / TotalSeeks, ChunkEndSeekSeconds * 1e6 / TotalSeeks,
+		Bytes / 1024.0 / NumAvatars / (NumFrames / FrameRate / 60.0));
+}
+
+static FAutoConsoleCommand CmdIKPoseStreamBenchmark(
+	TEXT("IKBody.Replay.Benchmark"),
+	TEXT("Records and plays back synthetic pose streams, logs the encode and decode rate, seek times and size per avatar-minute. Optional arguments: avatars (16), seconds (60), frames per chunk (30)."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&IKPoseStreamBenchmark));
@@ -0,0 +1,284 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Solver/IKBodyBatchSolver.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+#if INTEL_ISPC
+#include "IKBodyBatchSolver.ispc.generated.h"
+#endif
+
+#if !defined(IKBODY_ISPC_ENABLED_DEFAULT)
+#define IKBODY_ISPC_ENABLED_DEFAULT 1
+#endif
+
+// Support run-time toggling on supported platforms in non-shipping configurations
+#if !INTEL_ISPC || UE_BUILD_SHIPPING
+static constexpr bool bIKBody_ISPC_Enabled = INTEL_ISPC && IKBODY_ISPC_ENABLED_DEFAULT;
+#else
+static bool bIKBody_ISPC_Enabled = IKBODY_ISPC_ENABLED_DEFAULT;
+static FAutoConsoleVariableRef CVarIKBodyISPCEnabled(TEXT("IKBody.ISPC"), bIKBody_ISPC_Enabled, TEXT("Whether to use ISPC optimizations in the batched body solve."));
+
+static bool bIKBody_ISPC_Validate = false;
+static FAutoConsoleVariableRef CVarIKBodyISPCValidate(TEXT("IKBody.ISPC.Validate"), bIKBody_ISPC_Validate, TEXT("Also run the scalar body solve and log every output that isn't bit-identical to the ISPC result."));
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogIKBodySolver, Log, All);
+
+/*
+ * Same polynomial as FMath::Atan2, spelled out so the ISPC kernel can use the exact same operations
+*/
+static float IKAtan2(float Y, float X)
+{
+	const float AbsX = FMath::Abs(X);
+	const float AbsY = FMath::Abs(Y);
+	const bool YAbsBigger = AbsY > AbsX;
+	float T0 = YAbsBigger ? AbsY : AbsX;
+	float T1 = YAbsBigger ? AbsX : AbsY;
+
+	if (T0 == 0.0f)
+		return 0.0f;
+
+	float T3 = T1 / T0;
+	const float T4 = T3 * T3;
+
+	T0 = +7.2128853633444123e-03f;
+	T0 = T0 * T4 - 3.5059680836411644e-02f;
+	T0 = T0 * T4 + 8.1675882859940430e-02f;
+	T0 = T0 * T4 - 1.3374657325451267e-01f;
+	T0 = T0 * T4 + 1.9856563505717162e-01f;
+	T0 = T0 * T4 - 3.3324998579202170e-01f;
+	T0 = T0 * T4 + 1.0f;
+	T3 = T0 * T3;
+
+	T3 = YAbsBigger ? (0.5f * UE_PI) - T3 : T3;
+	T3 = (X < 0.0f) ? UE_PI - T3 : T3;
+	T3 = (Y < 0.0f) ? -T3 : T3;
+	return T3;
+}
+
+void FIKBodySolveBatch::SetNum(int32 NumBodies)
+{
+	for (TArray<float>* Array : {
+		&CameraX, &CameraY, &CameraZ, &ForwardX, &ForwardY, &ForwardZ, &CameraYaw,
+		&LastX, &LastY, &LastForwardX, &LastForwardY, &LastForwardZ, &LastYaw,
+		&BodyOffset, &MovementThreshold, &RotationThreshold,
+		&TargetX, &TargetY, &TargetZ, &Distance, &Direction, &YawDifference })
+	{
+		Array->SetNumUninitialized(NumBodies, false);
+	}
+
+	this->Flags.SetNumUninitialized(NumBodies, false);
+}
+
+void FIKBodySolveBatch::SolveScalar(int32 Begin, int32 End)
+{
+	for (int32 i = Begin; i < End; ++i)
+	{
+		// Body target is the camera location moved along the camera forward to avoid clipping
+		this->TargetX[i] = this->CameraX[i] + this->ForwardX[i] * this->BodyOffset[i];
+		this->TargetY[i] = this->CameraY[i] + this->ForwardY[i] * this->BodyOffset[i];
+		this->TargetZ[i] = this->CameraZ[i] + this->ForwardZ[i] * this->BodyOffset[i];
+
+		// XY distance moved since the last step
+		const float DeltaX = this->CameraX[i] - this->LastX[i];
+		const float DeltaY = this->CameraY[i] - this->LastY[i];
+		this->Distance[i] = FMath::Sqrt(DeltaX * DeltaX + DeltaY * DeltaY);
+		this->YawDifference[i] = FMath::Abs(this->CameraYaw[i] - this->LastYaw[i]);
+
+		// Signed angle between the last and current forward vectors, using the Z of the rotation axis as the left-right sign
+		const float CrossX = this->LastForwardY[i] * this->ForwardZ[i] - this->LastForwardZ[i] * this->ForwardY[i];
+		const float CrossY = this->LastForwardZ[i] * this->ForwardX[i] - this->LastForwardX[i] * this->ForwardZ[i];
+		const float CrossZ = this->LastForwardX[i] * this->ForwardY[i] - this->LastForwardY[i] * this->ForwardX[i];
+		const float Dot = this->LastForwardX[i] * this->ForwardX[i] + this->LastForwardY[i] * this->ForwardY[i] + this->LastForwardZ[i] * this->ForwardZ[i];
+		const float CrossLength = FMath::Sqrt(CrossX * CrossX + CrossY * CrossY + CrossZ * CrossZ);
+		this->Direction[i] = CrossLength > 0.0f ? (CrossZ / CrossLength) * IKAtan2(CrossLength, Dot) * (180.0f / UE_PI) : 0.0f;
+
+		this->Flags[i] = (this->Distance[i] > this->MovementThreshold[i] ? EIKBodySolveFlags::Moved : 0)
+			| (this->YawDifference[i] > this->RotationThreshold[i] ? EIKBodySolveFlags::Rotated : 0);
+	}
+}
+
+#if INTEL_ISPC
+/*
+ * Compares every output of two solves of the same input bit for bit, logging the first body that differs.
+ * Returns the number of bodies that differ.
+*/
+static int32 CountMismatches(const FIKBodySolveBatch& Solved, const FIKBodySolveBatch& Scalar)
+{
+	int32 Mismatches = 0;
+	for (int32 i = 0; i < Solved.Num(); ++i)
+	{
+		const bool Identical = Scalar.Flags[i] == Solved.Flags[i]
+			&& FMemory::Memcmp(&Scalar.TargetX[i], &Solved.TargetX[i], sizeof(float)) == 0
+			&& FMemory::Memcmp(&Scalar.TargetY[i], &Solved.TargetY[i], sizeof(float)) == 0
+			&& FMemory::Memcmp(&Scalar.TargetZ[i], &Solved.TargetZ[i], sizeof(float)) == 0
+			&& FMemory::Memcmp(&Scalar.Distance[i], &Solved.Distance[i], sizeof(float)) == 0
+			&& FMemory::Memcmp(&Scalar.Direction[i], &Solved.Direction[i], sizeof(float)) == 0
+			&& FMemory::Memcmp(&Scalar.YawDifference[i], &Solved.YawDifference[i], sizeof(float)) == 0;
+
+		if (!Identical && Mismatches++ == 0)
+		{
+			UE_LOG(LogIKBodySolver, Warning, TEXT("ISPC body solve differs from scalar for body %d: direction %.9g vs %.9g, distance %.9g vs %.9g"),
+				i, Solved.Direction[i], Scalar.Direction[i], Solved.Distance[i], Scalar.Distance[i]);
+		}
+	}
+
+	return Mismatches;
+}
+#endif
+
+/*
+ * ISPC results are only used once they're known to be bit-identical to the scalar solve on this machine.
+ * Targets with fused multiply-add can contract the kernel's multiply-adds, which rounds differently than the scalar code.
+*/
+static bool IsISPCBitIdentical()
+{
+	static const bool bIdentical = FIKBodySolveBatch::TestDeterminism() == 0;
+	return bIdentical;
+}
+
+void FIKBodySolveBatch::Solve()
+{
+	const int32 NumBodies = this->Num();
+	if (NumBodies == 0)
+		return;
+
+	if (!bIKBody_ISPC_Enabled || !IsISPCBitIdentical())
+	{
+		this->SolveScalar(0, NumBodies);
+		return;
+	}
+
+	this->SolveISPC();
+
+#if INTEL_ISPC && !UE_BUILD_SHIPPING
+	if (bIKBody_ISPC_Validate)
+	{
+		// Re-solve with the scalar path and compare every output bit for bit
+		FIKBodySolveBatch Scalar = *this;
+		Scalar.SolveScalar(0, NumBodies);
+
+		const int32 Mismatches = CountMismatches(*this, Scalar);
+		if (Mismatches > 0)
+		{
+			UE_LOG(LogIKBodySolver, Warning, TEXT("ISPC body solve: %d of %d bodies are not bit-identical to the scalar solve."), Mismatches, NumBodies);
+		}
+	}
+#endif
+}
+
+void FIKBodySolveBatch::SolveISPC()
+{
+#if INTEL_ISPC
+	ispc::SolveBodyBatch(
+		this->CameraX.GetData(), this->CameraY.GetData(), this->CameraZ.GetData(),
+		this->ForwardX.GetData(), this->ForwardY.GetData(), this->ForwardZ.GetData(), this->CameraYaw.GetData(),
+		this->LastX.GetData(), this->LastY.GetData(),
+		this->LastForwardX.GetData(), this->LastForwardY.GetData(), this->LastForwardZ.GetData(), this->LastYaw.GetData(),
+		this->BodyOffset.GetData(), this->MovementThreshold.GetData(), this->RotationThreshold.GetData(),
+		this->TargetX.GetData(), this->TargetY.GetData(), this->TargetZ.GetData(),
+		this->Distance.GetData(), this->Direction.GetData(), this->YawDifference.GetData(), this->Flags.GetData(),
+		this->Num());
+#else
+	this->SolveScalar(0, this->Num());
+#endif
+}
+
+/*
+ * Zero movement, yaw around the +/-180 degree wrap, parallel, opposite, vertical and degenerate forward vectors, tiny and huge coordinates,
+ * followed by seeded random bodies. The body count isn't a multiple of any ISPC gang size, so the kernel's partial gang is covered too.
+*/
+int32 FIKBodySolveBatch::TestDeterminism()
+{
+#if INTEL_ISPC
+	struct FCase { float Camera[3]; float Forward[3]; float Yaw; float Last[2]; float LastForward[3]; float LastYaw; };
+	static const FCase Cases[] = {
+		{ { 0.0f, 0.0f, 170.0f }, { 1.0f, 0.0f, 0.0f }, 0.0f, { 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 0.0f },
+		{ { -0.0f, -0.0f, 0.0f }, { -0.0f, 1.0f, 0.0f }, -0.0f, { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 0.0f },
+		{ { 10.0f, 0.0f, 170.0f }, { -1.0f, 0.0001f, 0.0f }, 179.99f, { 0.0f, 0.0f }, { -1.0f, -0.0001f, 0.0f }, -179.99f },
+		{ { 0.0f, 10.0f, 170.0f }, { -1.0f, 0.0f, 0.0f }, 180.0f, { 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, -180.0f },
+		{ { 0.0f, 0.0f, 170.0f }, { -1.0f, 0.0f, 0.0f }, 180.0f, { 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 0.0f },
+		{ { 0.0f, 0.0f, 170.0f }, { 0.0f, 0.0f, 1.0f }, 0.0f, { 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 0.0f },
+		{ { 0.0f, 0.0f, 170.0f }, { 0.0f, 0.0f, -1.0f }, 90.0f, { 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, -90.0f },
+		{ { 5.0f, 5.0f, 170.0f }, { 0.0f, 0.0f, 0.0f }, 0.0f, { 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 0.0f },
+		{ { 5.0f, 5.0f, 170.0f }, { 0.0f, 0.0f, 0.0f }, 0.0f, { 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, 0.0f },
+		{ { 1e-30f, -1e-30f, 1e-38f }, { 1e-20f, 1e-20f, 0.0f }, 1e-30f, { -1e-30f, 1e-30f }, { 1e-20f, -1e-20f, 0.0f }, 0.0f },
+		{ { 2e6f, -2e6f, 170.0f }, { 0.7071068f, 0.7071068f, 0.0f }, 45.0f, { -2e6f, 2e6f }, { 0.7071068f, -0.7071068f, 0.0f }, -45.0f },
+		{ { 60.0f, 0.0f, 170.0f }, { 1.0f, 0.0f, 0.0f }, 25.0f, { 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 0.0f },
+	};
+
+	FIKBodySolveBatch Batch;
+	Batch.SetNum(UE_ARRAY_COUNT(Cases) + 1021);
+
+	FRandomStream Random(0x1CB0D7);
+	for (int32 i = 0; i < Batch.Num(); ++i)
+	{
+		FCase Case;
+		if (i < UE_ARRAY_COUNT(Cases)) Case = Cases[i];
+		else
+		{
+			const FVector3f Forward = FVector3f(Random.GetUnitVector());
+			const FVector3f LastForward = FVector3f(Random.GetUnitVector());
+			Case = { { Random.FRandRange(-1e4f, 1e4f), Random.FRandRange(-1e4f, 1e4f), Random.FRandRange(0.0f, 250.0f) },
+				{ Forward.X, Forward.Y, Forward.Z }, Random.FRandRange(-180.0f, 180.0f),
+				{ Random.FRandRange(-1e4f, 1e4f), Random.FRandRange(-1e4f, 1e4f) },
+				{ LastForward.X, LastForward.Y, LastForward.Z }, Random.FRandRange(-180.0f, 180.0f) };
+		}
+
+		Batch.CameraX[i] = Case.Camera[0];
+		Batch.CameraY[i] = Case.Camera[1];
+		Batch.CameraZ[i] = Case.Camera[2];
+		Batch.ForwardX[i] = Case.Forward[0];
+		Batch.ForwardY[i] = Case.Forward[1];
+		Batch.ForwardZ[i] = Case.Forward[2];
+		Batch.CameraYaw[i] = Case.Yaw;
+		Batch.LastX[i] = Case.Last[0];
+		Batch.LastY[i] = Case.Last[1];
+		Batch.LastForwardX[i] = Case.LastForward[0];
+		Batch.LastForwardY[i] = Case.LastForward[1];
+		Batch.LastForwardZ[i] = Case.LastForward[2];
+		Batch.LastYaw[i] = Case.LastYaw;
+		Batch.BodyOffset[i] = -20.0f;
+		Batch.MovementThreshold[i] = 60.0f;
+		Batch.RotationThreshold[i] = 25.0f;
+	}
+
+	FIKBodySolveBatch Scalar = Batch;
+	Batch.SolveISPC();
+	Scalar.SolveScalar(0, Scalar.Num());
+
+	const int32 Mismatches = CountMismatches(Batch, Scalar);
+	if (Mismatches > 0)
+	{
+		UE_LOG(LogIKBodySolver, Warning, TEXT("ISPC body solve: %d of %d test bodies are not bit-identical to the scalar solve, bodies are solved with the scalar implementation."), Mismatches, Batch.Num());
+	}
+	else UE_LOG(LogIKBodySolver, Log, TEXT("ISPC body solve is bit-identical to the scalar solve for %d test bodies."), Batch.Num());
+
+	return Mismatches;
+#else
+	return 0;
+#endif
+}
+
+static void IKBodyISPCTest()
+{
+#if INTEL_ISPC
+	const int32 Mismatches = FIKBodySolveBatch::TestDeterminism();
+	UE_LOG(LogIKBodySolver, Display, TEXT("IKBody.ISPC.Test: %s"), Mismatches == 0 ? TEXT("passed") : TEXT("FAILED"));
+#else
+	UE_LOG(LogIKBodySolver, Display, TEXT("IKBody.ISPC.Test: ISPC isn't available on this platform, bodies are solved with the scalar implementation"));
+#endif
+}
+
+static FAutoConsoleCommand CmdIKBodyISPCTest(
+	TEXT("IKBody.ISPC.Test"),
+	TEXT("Solves fixed and edge case bodies (zero movement, yaw at +/-180 degrees, degenerate forward vectors) with ISPC and the scalar solve, and logs whether every output is bit-identical."),
+	FConsoleCommandDelegate::CreateStatic(&IKBodyISPCTest));
@@ -0,0 +1,191 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Solver/IKClimbSolver.h"
+#include "Solver/IKBodyBatchSolver.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogIKBodyClimbSolver, Log, All);
+
+static int32 GIKBodyClimbMaxIterations = 8;
+static FAutoConsoleVariableRef CVarIKBodyClimbMaxIterations(
+	TEXT("IKBody.Climb.MaxIterations"),
+	GIKBodyClimbMaxIterations,
+	TEXT("Most iterations of the climbing body solve per tick, it continues from there the next tick."));
+
+static float GIKBodyClimbTolerance = 0.1f;
+static FAutoConsoleVariableRef CVarIKBodyClimbTolerance(
+	TEXT("IKBody.Climb.Tolerance"),
+	GIKBodyClimbTolerance,
+	TEXT("Distance the climbing body moves in an iteration below which it is considered solved."));
+
+// Shoulder height as a fraction of the player height
+static constexpr float ShoulderHeightRatio = 0.82f;
+
+void FIKClimbSolver::Reset(const FVector& InRoot, float InYaw)
+{
+	this->Root = InRoot;
+	this->Yaw = InYaw;
+	this->bConverged = false;
+}
+
+static bool IsNearlyEqual(const FIKClimbSolveInput& A, const FIKClimbSolveInput& B, float Tolerance)
+{
+	return A.Head.Equals(B.Head, Tolerance) && A.bAnchored[0] == B.bAnchored[0] && A.bAnchored[1] == B.bAnchored[1]
+		&& (!A.bAnchored[0] || A.Anchors[0].Equals(B.Anchors[0], Tolerance))
+		&& (!A.bAnchored[1] || A.Anchors[1].Equals(B.Anchors[1], Tolerance));
+}
+
+int32 FIKClimbSolver::Solve(const FIKClimbSolveInput& Input)
+{
+	const float Tolerance = FMath::Max(GIKBodyClimbTolerance, KINDA_SMALL_NUMBER);
+	if (this->bConverged && IsNearlyEqual(Input, this->LastInput, Tolerance))
+		return 0;
+
+	this->LastInput = Input;
+	this->bConverged = false;
+
+	// Face the wall, from the head towards the grips
+	FVector Grip = FVector::ZeroVector;
+	int32 NumAnchors = 0;
+	for (int32 Hand = 0; Hand < 2; ++Hand)
+	{
+		if (Input.bAnchored[Hand])
+		{
+			Grip += Input.Anchors[Hand];
+			++NumAnchors;
+		}
+	}
+
+	const FVector ToGrip = NumAnchors > 0 ? Grip / NumAnchors - Input.Head : FVector::ZeroVector;
+	if (ToGrip.SizeSquared2D() > 1.0f) this->Yaw = FMath::RadiansToDegrees(FMath::Atan2(ToGrip.Y, ToGrip.X));
+
+	const FQuat Rotation = FQuat(FVector::UpVector, FMath::DegreesToRadians(this->Yaw));
+	const FVector Forward = Rotation.GetForwardVector();
+	const FVector Shoulders[2] = {
+		Rotation.RotateVector(FVector(0.0f, -Input.ShoulderWidth * 0.5f, Input.PlayerHeight * ShoulderHeightRatio)),
+		Rotation.RotateVector(FVector(0.0f, Input.ShoulderWidth * 0.5f, Input.PlayerHeight * ShoulderHeightRatio))
+	};
+
+	// Below the head as when walking, pulled halfway there every iteration and held back by the arms
+	const FVector HeadRoot = Input.Head + Forward * Input.BodyOffset - FVector(0.0f, 0.0f, Input.PlayerHeight);
+	const int32 MaxIterations = FMath::Max(GIKBodyClimbMaxIterations, 1);
+	int32 Iteration = 0;
+	while (Iteration < MaxIterations)
+	{
+		++Iteration;
+		const FVector Previous = this->Root;
+		this->Root = FMath::Lerp(this->Root, HeadRoot, 0.5f);
+
+		for (int32 Hand = 0; Hand < 2; ++Hand)
+		{
+			if (!Input.bAnchored[Hand]) continue;
+
+			const FVector ToAnchor = Input.Anchors[Hand] - (this->Root + Shoulders[Hand]);
+			const float Distance = ToAnchor.Size();
+			if (Distance > Input.ArmLength) this->Root += ToAnchor * (1.0f - Input.ArmLength / Distance);
+		}
+
+		if (FVector::DistSquared(this->Root, Previous) < Tolerance * Tolerance)
+		{
+			this->bConverged = true;
+			break;
+		}
+	}
+
+	return Iteration;
+}
+
+/*
+ * Times the walking solve of a single body against the climbing solve on synthetic input, per tick.
+ * Climbing is measured with a climber pulling up between regrips, and with a climber hanging still.
+*/
+static void IKBodyClimbBenchmark(const TArray<FString>& Args)
+{
+	const int32 Ticks = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+
+	// Walking: a body that isn't solved in a batch with others, stepping forward while looking around
+	FIKBodySolveBatch Batch;
+	Batch.SetNum(1);
+	Batch.BodyOffset[0] = -20.0f;
+	Batch.MovementThreshold[0] = 10.0f;
+	Batch.RotationThreshold[0] = 25.0f;
+	Batch.LastForwardX[0] = 1.0f;
+	int32 Steps = 0;
+
+	double Start = FPlatformTime::Seconds();
+	for (int32 Tick = 0; Tick < Ticks; ++Tick)
+	{
+		const float Yaw = FMath::Sin(Tick * 0.01f) * 60.0f;
+		Batch.CameraX[0] = Tick * 0.5f;
+		Batch.CameraY[0] = FMath::Sin(Tick * 0.02f) * 10.0f;
+		Batch.CameraZ[0] = 170.0f;
+		Batch.ForwardX[0] = FMath::Cos(FMath::DegreesToRadians(Yaw));
+		Batch.ForwardY[0] = FMath::Sin(FMath::DegreesToRadians(Yaw));
+		Batch.ForwardZ[0] = 0.0f;
+		Batch.CameraYaw[0] = Yaw;
+		Batch.Solve();
+
+		if (Batch.Flags[0] & EIKBodySolveFlags::Moved)
+		{
+			Batch.LastX[0] = Batch.CameraX[0];
+			Batch.LastY[0] = Batch.CameraY[0];
+			Batch.LastForwardX[0] = Batch.ForwardX[0];
+			Batch.LastForwardY[0] = Batch.ForwardY[0];
+			Batch.LastForwardZ[0] = Batch.ForwardZ[0];
+			++Steps;
+		}
+
+		if (Batch.Flags[0] & EIKBodySolveFlags::Rotated) Batch.LastYaw[0] = Yaw;
+	}
+	const double WalkingSeconds = FPlatformTime::Seconds() - Start;
+
+	// Climbing: regrip 40 units higher every second at 90 ticks per second, pulling the head up in between
+	FIKClimbSolveInput Input;
+	Input.PlayerHeight = 170.0f;
+	Input.BodyOffset = -20.0f;
+	Input.ArmLength = 65.0f;
+	Input.ShoulderWidth = 36.0f;
+	Input.bAnchored[0] = Input.bAnchored[1] = true;
+
+	FIKClimbSolver Solver;
+	Solver.Reset(FVector::ZeroVector, 0.0f);
+	int64 Iterations = 0;
+
+	Start = FPlatformTime::Seconds();
+	for (int32 Tick = 0; Tick < Ticks; ++Tick)
+	{
+		const int32 Grip = Tick / 90;
+		const float Pull = (Tick % 90) / 90.0f * 40.0f;
+		Input.Anchors[0] = FVector(30.0f, -20.0f, 200.0f + Grip * 40.0f + ((Grip & 1) ? 40.0f : 0.0f));
+		Input.Anchors[1] = FVector(30.0f, 20.0f, 200.0f + Grip * 40.0f + ((Grip & 1) ? 0.0f : 40.0f));
+		Input.Head = FVector(0.0f, 0.0f, 170.0f + Grip * 40.0f + Pull);
+		Iterations += Solver.Solve(Input);
+	}
+	const double ClimbingSeconds = FPlatformTime::Seconds() - Start;
+	const int64 ClimbingIterations = Iterations;
+
+	// Hanging still: after the first solve the previous solution holds
+	Iterations = 0;
+	Start = FPlatformTime::Seconds();
+	for (int32 Tick = 0; Tick < Ticks; ++Tick)
+	{
+		Iterations += Solver.Solve(Input);
+	}
+	const double HangingSeconds = FPlatformTime::Seconds() - Start;
+
+	UE_LOG(LogIKBodyClimbSolver, Display, TEXT("%d ticks, ns per tick: walking %.1f (%d steps), climbing %.1f (%.2f iterations), hanging %.1f (%.2f iterations)"),
+		Ticks, WalkingSeconds * 1e9 / Ticks, Steps, ClimbingSeconds * 1e9 / Ticks, (double) ClimbingIterations / Ticks,
+		HangingSeconds * 1e9 / Ticks, (double) Iterations / Ticks);
+}
+
+static FAutoConsoleCommand CmdIKBodyClimbBenchmark(
+	TEXT("IKBody.Climb.Benchmark"),
+	TEXT("Logs the per tick cost of the walking and the climbing body solve on synthetic input. Optional argument: number of ticks (100000)."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&IKBodyClimbBenchmark));
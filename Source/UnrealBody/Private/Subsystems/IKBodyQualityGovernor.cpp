@@ -0,0 +1,137 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Subsystems/IKBodyQualityGovernor.h"
+#include "UnrealBody.h"
+#include "RenderCore.h"
+#include "RHI.h"
+
+DEFINE_LOG_CATEGORY(LogIKBodyGovernor);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Quality Level"), STAT_IKBody_QualityLevel, STATGROUP_IKBody);
+
+static int32 GIKBodyGovernorEnabled = 0;
+static FAutoConsoleVariableRef CVarIKBodyGovernorEnabled(
+	TEXT("IKBody.Governor"),
+	GIKBodyGovernorEnabled,
+	TEXT("Step IK quality down when the frame work time is over IKBody.Governor.TargetMs. Off until the target is configured for the project."));
+
+static float GIKBodyGovernorTargetMs = 11.1f;
+static FAutoConsoleVariableRef CVarIKBodyGovernorTargetMs(
+	TEXT("IKBody.Governor.TargetMs"),
+	GIKBodyGovernorTargetMs,
+	TEXT("Frame work time in milliseconds the governor keeps IK quality under, e.g. 11.1 for 90 Hz. Work time is the busiest of the game thread, render thread and GPU, without vsync or frame rate cap waits."));
+
+static float GIKBodyGovernorStepUpRatio = 0.85f;
+static FAutoConsoleVariableRef CVarIKBodyGovernorStepUpRatio(
+	TEXT("IKBody.Governor.StepUpRatio"),
+	GIKBodyGovernorStepUpRatio,
+	TEXT("Fraction of the target the frame work time has to stay under before quality steps back up."));
+
+static int32 GIKBodyGovernorStepDownFrames = 30;
+static FAutoConsoleVariableRef CVarIKBodyGovernorStepDownFrames(
+	TEXT("IKBody.Governor.StepDownFrames"),
+	GIKBodyGovernorStepDownFrames,
+	TEXT("Consecutive frames over the target before quality steps down."));
+
+static int32 GIKBodyGovernorStepUpFrames = 180;
+static FAutoConsoleVariableRef CVarIKBodyGovernorStepUpFrames(
+	TEXT("IKBody.Governor.StepUpFrames"),
+	GIKBodyGovernorStepUpFrames,
+	TEXT("Consecutive frames under the step up threshold before quality steps back up."));
+
+static FAutoConsoleCommand CmdIKBodyGovernorLevel(
+	TEXT("IKBody.Governor.Level"),
+	TEXT("Prints the current IK quality level. With an argument pins the level (0 full to 3 reduced body tick), -1 releases it."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FIKBodyQualityGovernor& Governor = FIKBodyQualityGovernor::Get();
+		if (Args.Num() > 0)
+		{
+			Governor.SetForcedLevel(FCString::Atoi(*Args[0]));
+		}
+
+		UE_LOG(LogIKBodyGovernor, Display, TEXT("IK quality level %s (frame work time %.2f ms, target %.2f ms)"),
+			*UEnum::GetValueAsString(Governor.GetLevel()), Governor.GetSmoothedFrameMs(), GIKBodyGovernorTargetMs);
+	}));
+
+FIKBodyQualityGovernor& FIKBodyQualityGovernor::Get()
+{
+	static FIKBodyQualityGovernor Governor;
+	return Governor;
+}
+
+void FIKBodyQualityGovernor::SetForcedLevel(int32 InLevel)
+{
+	this->ForcedLevel = InLevel < 0 ? INDEX_NONE : FMath::Min(InLevel, (int32) EIKBodyQualityLevel::ReducedBodyTick);
+}
+
+void FIKBodyQualityGovernor::SetLevel(EIKBodyQualityLevel NewLevel)
+{
+	UE_LOG(LogIKBodyGovernor, Log, TEXT("IK quality %s -> %s (frame work time %.2f ms, target %.2f ms)"),
+		*UEnum::GetValueAsString(this->Level), *UEnum::GetValueAsString(NewLevel), this->SmoothedFrameMs, GIKBodyGovernorTargetMs);
+
+	this->Level = NewLevel;
+	this->OverBudgetFrames = 0;
+	this->UnderBudgetFrames = 0;
+}
+
+/*
+ * Busy time of the slowest of the game thread, render thread and GPU in the last frame.
+ * Unlike the frame's delta time it doesn't include waiting for vsync or a frame rate cap, so a capped frame isn't over budget.
+ * Without thread times (e.g. on a dedicated server) the time the world spent ticking is used instead.
+*/
+static float GetFrameWorkMs(float WorldTickMs)
+{
+	const uint32 Cycles = FMath::Max3(GGameThreadTime, GRenderThreadTime, RHIGetGPUFrameCycles());
+	return Cycles > 0 ? (float) FPlatformTime::ToMilliseconds(Cycles) : WorldTickMs;
+}
+
+void FIKBodyQualityGovernor::Tick(float WorldTickMs)
+{
+	// Every world ticks the governor, the frame is only measured once
+	if (this->LastTickFrame == GFrameCounter)
+		return;
+
+	this->LastTickFrame = GFrameCounter;
+	SET_DWORD_STAT(STAT_IKBody_QualityLevel, (uint32) this->GetLevel());
+
+	if (GIKBodyGovernorEnabled == 0 || GIKBodyGovernorTargetMs <= 0.0f)
+	{
+		if (this->Level != EIKBodyQualityLevel::Full) this->SetLevel(EIKBodyQualityLevel::Full);
+		return;
+	}
+
+	// Smooth out single slow frames, such as loading hitches
+	const float FrameMs = GetFrameWorkMs(WorldTickMs);
+	this->SmoothedFrameMs = this->SmoothedFrameMs > 0.0f ? FMath::Lerp(this->SmoothedFrameMs, FrameMs, 0.1f) : FrameMs;
+
+	if (this->SmoothedFrameMs > GIKBodyGovernorTargetMs)
+	{
+		this->UnderBudgetFrames = 0;
+		if (++this->OverBudgetFrames >= GIKBodyGovernorStepDownFrames && this->Level != EIKBodyQualityLevel::ReducedBodyTick)
+		{
+			this->SetLevel((EIKBodyQualityLevel) ((uint8) this->Level + 1));
+		}
+	}
+	else if (this->SmoothedFrameMs < GIKBodyGovernorTargetMs * GIKBodyGovernorStepUpRatio)
+	{
+		this->OverBudgetFrames = 0;
+		if (++this->UnderBudgetFrames >= GIKBodyGovernorStepUpFrames && this->Level != EIKBodyQualityLevel::Full)
+		{
+			this->SetLevel((EIKBodyQualityLevel) ((uint8) this->Level - 1));
+		}
+	}
+	else
+	{
+		// Between the thresholds the level holds
+		this->OverBudgetFrames = 0;
+		this->UnderBudgetFrames = 0;
+	}
+}
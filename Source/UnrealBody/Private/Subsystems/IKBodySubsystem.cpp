@@ -0,0 +1,572 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Subsystems/IKBodySubsystem.h"
+#include "CharacterComponents/IKBodyComponent.h"
+#include "UnrealBody.h"
+#include "EngineUtils.h"
+#include "Engine/Level.h"
+#include "Subsystems/IKBodyQualityGovernor.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Input/IKMockHandInputSource.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batched Body Solve"), STAT_IKBody_SolveBodies, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bodies Solved"), STAT_IKBody_BodiesSolved, STATGROUP_IKBody);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cached Ground Samples"), STAT_IKBody_CachedGroundSamples, STATGROUP_IKBody);
+DECLARE_CYCLE_STAT(TEXT("Pose Sharing"), STAT_IKBody_PoseSharing, STATGROUP_IKBody);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pose Sharing Leaders"), STAT_IKBody_PoseSharingLeaders, STATGROUP_IKBody);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pose Sharing Followers"), STAT_IKBody_PoseSharingFollowers, STATGROUP_IKBody);
+
+static int32 GIKBodyPoseSharing = 0;
+static FAutoConsoleVariableRef CVarIKBodyPoseSharing(
+	TEXT("IKBody.PoseSharing"),
+	GIKBodyPoseSharing,
+	TEXT("1 lets distant bodies in the same movement state copy the pose of one leader body instead of evaluating their own animation."));
+
+static float GIKBodyPoseSharingDistance = 3000.0f;
+static FAutoConsoleVariableRef CVarIKBodyPoseSharingDistance(
+	TEXT("IKBody.PoseSharing.Distance"),
+	GIKBodyPoseSharingDistance,
+	TEXT("Distance from every local view beyond which a body may share its pose."));
+
+static float GIKBodyPoseSharingInterval = 0.25f;
+static FAutoConsoleVariableRef CVarIKBodyPoseSharingInterval(
+	TEXT("IKBody.PoseSharing.Interval"),
+	GIKBodyPoseSharingInterval,
+	TEXT("Seconds between regrouping bodies by their movement state."));
+
+static float GIKBodyPoseSharingSpeedStep = 1.0f;
+static FAutoConsoleVariableRef CVarIKBodyPoseSharingSpeedStep(
+	TEXT("IKBody.PoseSharing.SpeedStep"),
+	GIKBodyPoseSharingSpeedStep,
+	TEXT("Movement speeds within this step of each other share a pose."));
+
+static float GIKBodyPoseSharingDirectionStep = 45.0f;
+static FAutoConsoleVariableRef CVarIKBodyPoseSharingDirectionStep(
+	TEXT("IKBody.PoseSharing.DirectionStep"),
+	GIKBodyPoseSharingDirectionStep,
+	TEXT("Degrees of movement direction that share a pose."));
+
+static float GIKBodyPoseSharingMaxSlope = 10.0f;
+static FAutoConsoleVariableRef CVarIKBodyPoseSharingMaxSlope(
+	TEXT("IKBody.PoseSharing.MaxSlope"),
+	GIKBodyPoseSharingMaxSlope,
+	TEXT("Steepest ground in degrees a body can share its pose on, the shared pose has no foot IK of its own."));
+
+static void IKBodyHandInputBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UIKBodySubsystem* Subsystem = World != nullptr ? World->GetSubsystem<UIKBodySubsystem>() : nullptr;
+	if (Subsystem != nullptr)
+	{
+		Subsystem->StartHandInputBenchmark(Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 300);
+	}
+}
+
+static FAutoConsoleCommand CmdIKBodyHandInputBenchmark(
+	TEXT("IKBody.HandInput.Benchmark"),
+	TEXT("Drives the fingers of every body from a mock hand input source and logs the time from setting the input to the evaluated pose. Optional argument: number of frames (300)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&IKBodyHandInputBenchmark));
+
+static void IKBodyServerBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UIKBodySubsystem* Subsystem = World != nullptr ? World->GetSubsystem<UIKBodySubsystem>() : nullptr;
+	if (Subsystem != nullptr)
+	{
+		Subsystem->BenchmarkServerTick(Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 300);
+	}
+}
+
+static FAutoConsoleCommand CmdIKBodyServerBenchmark(
+	TEXT("IKBody.Server.Benchmark"),
+	TEXT("Ticks every body and its animation headless and with the full cosmetic IK, and logs the microseconds per player of both. The bodies are restored afterwards, their animations have advanced by the ticked time. Optional argument: number of ticks (300)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&IKBodyServerBenchmark));
+
+void UIKBodySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	this->PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UIKBodySubsystem::OnWorldPreActorTick);
+	this->PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UIKBodySubsystem::OnWorldPostActorTick);
+	this->LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UIKBodySubsystem::OnLevelAddedToWorld);
+	this->LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UIKBodySubsystem::OnLevelRemovedFromWorld);
+}
+
+void UIKBodySubsystem::Deinitialize()
+{
+	if (this->SolveTickFunction.IsTickFunctionRegistered()) this->SolveTickFunction.UnRegisterTickFunction();
+	FWorldDelegates::OnWorldPreActorTick.Remove(this->PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(this->PostActorTickHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(this->LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(this->LevelRemovedHandle);
+	if (GetWorld() != nullptr) GetWorld()->RemoveOnActorSpawnedHandler(this->ActorSpawnedHandle);
+	Super::Deinitialize();
+}
+
+void UIKBodySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Registered bodies and their pawns are added as prerequisites of the solve, see RegisterBody
+	this->SolveTickFunction.Subsystem = this;
+	this->SolveTickFunction.bCanEverTick = true;
+	this->SolveTickFunction.TickGroup = TG_PrePhysics;
+	this->SolveTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+
+	for (TActorIterator<AActor> It(&InWorld); It; ++It)
+	{
+		this->OnActorSpawned(*It);
+	}
+
+	this->ActorSpawnedHandle = InWorld.AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UIKBodySubsystem::OnActorSpawned));
+}
+
+void UIKBodySubsystem::OnActorSpawned(AActor* Actor)
+{
+	if (Actor == nullptr)
+		return;
+
+	if (Actor->ActorHasTag(UIKGroundHeightCache::DynamicGroundTag))
+	{
+		this->RegisterDynamicGround(Actor);
+	}
+
+	if (Actor->ActorHasTag(FIKGripRegistry::GrippableTag))
+	{
+		this->RegisterGrippable(Actor);
+	}
+}
+
+void UIKBodySubsystem::OnLevelAddedToWorld(ULevel* Level, UWorld* World)
+{
+	// Levels loaded before begin play are registered with the rest of the world
+	if (Level == nullptr || World != GetWorld() || !World->HasBegunPlay())
+		return;
+
+	for (AActor* Actor : Level->Actors)
+	{
+		this->OnActorSpawned(Actor);
+	}
+}
+
+void UIKBodySubsystem::OnLevelRemovedFromWorld(ULevel* Level, UWorld* World)
+{
+	// A null level means every level of the world is going away
+	if (World != GetWorld())
+		return;
+
+	this->DynamicGround.RemoveAllSwap([Level](const TWeakObjectPtr<UPrimitiveComponent>& Ground)
+	{
+		return !Ground.IsValid() || Level == nullptr || Ground->GetComponentLevel() == Level;
+	}, false);
+
+	if (Level == nullptr)
+		return;
+
+	for (AActor* Actor : Level->Actors)
+	{
+		if (Actor != nullptr && Actor->ActorHasTag(FIKGripRegistry::GrippableTag)) this->UnregisterGrippable(Actor);
+	}
+}
+
+void UIKBodySubsystem::RegisterGrippable(AActor* Actor)
+{
+	if (Actor == nullptr || Actor->GetRootComponent() == nullptr || this->GripRegistry.Contains(Actor))
+		return;
+
+	this->GripRegistry.Add(Actor);
+	Actor->GetRootComponent()->TransformUpdated.AddUObject(this, &UIKBodySubsystem::OnGrippableMoved);
+	Actor->OnEndPlay.AddUniqueDynamic(this, &UIKBodySubsystem::OnGrippableEndPlay);
+}
+
+void UIKBodySubsystem::UnregisterGrippable(AActor* Actor)
+{
+	if (Actor == nullptr)
+		return;
+
+	this->GripRegistry.Remove(Actor);
+	if (Actor->GetRootComponent() != nullptr) Actor->GetRootComponent()->TransformUpdated.RemoveAll(this);
+	Actor->OnEndPlay.RemoveDynamic(this, &UIKBodySubsystem::OnGrippableEndPlay);
+}
+
+void UIKBodySubsystem::OnGrippableMoved(USceneComponent* Root, EUpdateTransformFlags Flags, ETeleportType Teleport)
+{
+	this->GripRegistry.Update(Root->GetOwner());
+}
+
+void UIKBodySubsystem::OnGrippableEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	this->UnregisterGrippable(Actor);
+}
+
+void UIKBodySubsystem::RegisterDynamicGround(AActor* Actor)
+{
+	TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+	for (UPrimitiveComponent* Component : Components)
+	{
+		if (Component->IsCollisionEnabled()) this->DynamicGround.AddUnique(Component);
+	}
+}
+
+bool UIKBodySubsystem::SampleCachedGround(const FVector& Location, float& OutHeight, FVector& OutNormal) const
+{
+	if (this->GroundHeightCache == nullptr)
+		return false;
+
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Ground : this->DynamicGround)
+	{
+		if (Ground.IsValid() && Ground->Bounds.GetBox().IsInsideXY(Location))
+			return false;
+	}
+
+	if (!this->GroundHeightCache->Sample(Location, OutHeight, OutNormal))
+		return false;
+
+	INC_DWORD_STAT(STAT_IKBody_CachedGroundSamples);
+	return true;
+}
+
+void UIKBodySubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld())
+		return;
+
+	// Measure the frame for the quality governor while there are bodies to govern
+	if (this->Bodies.Num() > 0 && this->ActorTickStartTime > 0.0)
+	{
+		FIKBodyQualityGovernor::Get().Tick((float) ((FPlatformTime::Seconds() - this->ActorTickStartTime) * 1000.0));
+	}
+
+	// Forget dynamic ground that was destroyed
+	this->DynamicGround.RemoveAllSwap([](const TWeakObjectPtr<UPrimitiveComponent>& Ground) { return !Ground.IsValid(); }, false);
+
+	this->UpdatePoseSharing(DeltaSeconds);
+
+	for (UIKBodyComponent* Body : this->Bodies)
+	{
+		Body->ApplyLateUpdate();
+
+		if (Body->MeasureHandInputLatency() && this->BenchmarkFramesLeft > 0 && Body->HandInputSource.GetObject() == this->BenchmarkInput)
+		{
+			this->BenchmarkLatencySum += Body->GetHandInputLatency();
+			this->BenchmarkLatencyMax = FMath::Max(this->BenchmarkLatencyMax, Body->GetHandInputLatency());
+			++this->BenchmarkSamples;
+		}
+	}
+
+	if (this->BenchmarkFramesLeft > 0 && --this->BenchmarkFramesLeft == 0)
+	{
+		this->FinishHandInputBenchmark();
+	}
+}
+
+void UIKBodySubsystem::StartHandInputBenchmark(int32 Frames)
+{
+	if (this->BenchmarkFramesLeft > 0)
+		return;
+
+	// Headless bodies don't sample hand input
+	this->BenchmarkInput = NewObject<UIKMockHandInputSource>(this);
+	for (UIKBodyComponent* Body : this->Bodies)
+	{
+		if (Body->IsHeadless() || Body->Body == nullptr) continue;
+
+		this->BenchmarkBodies.Emplace(Body, Body->HandInputSource.GetObject());
+		Body->SetHandInputSource(TScriptInterface<IIKHandInputSource>(this->BenchmarkInput));
+	}
+
+	if (this->BenchmarkBodies.Num() == 0)
+	{
+		UE_LOG(LogIKBodyComponent, Display, TEXT("Hand input benchmark: no bodies that sample hand input"));
+		this->BenchmarkInput = nullptr;
+		return;
+	}
+
+	this->BenchmarkFramesLeft = Frames;
+	this->BenchmarkSamples = 0;
+	this->BenchmarkLatencySum = 0.0;
+	this->BenchmarkLatencyMax = 0.0f;
+}
+
+/*
+ * Ticks the bodies the way a server would, once headless and once with all cosmetic IK, on the game thread within one frame.
+ * The bodies keep the input of the current frame while they're ticked. Headless meshes only tick their anim instance, full ones also evaluate their pose.
+*/
+void UIKBodySubsystem::BenchmarkServerTick(int32 Ticks)
+{
+	// Bodies playing back or recording a pose stream would skip or record the benchmark ticks
+	TArray<UIKBodyComponent*> Benchmarked;
+	for (UIKBodyComponent* Body : this->Bodies)
+	{
+		if (Body->Body != nullptr && Body->HasTrackedInput() && !Body->PoseReader.IsValid() && !Body->PoseWriter.IsValid()) Benchmarked.Add(Body);
+	}
+
+	if (Benchmarked.Num() == 0)
+	{
+		UE_LOG(LogIKBodyComponent, Display, TEXT("Server benchmark: no bodies to tick"));
+		return;
+	}
+
+	// The live bodies are ticked in place and put back as they were afterwards
+	TArray<UIKBodyComponent::FIKBodyTickSnapshot> Snapshots;
+	Snapshots.SetNum(Benchmarked.Num());
+	for (int32 Index = 0; Index < Benchmarked.Num(); ++Index)
+	{
+		Benchmarked[Index]->SaveTickSnapshot(Snapshots[Index]);
+	}
+
+	const float DeltaTime = 1.0f / 90.0f;
+	double Microseconds[2] = { 0.0, 0.0 };
+	for (int32 Headless = 1; Headless >= 0; --Headless)
+	{
+		for (UIKBodyComponent* Body : Benchmarked)
+		{
+			Body->TickState.bHeadless = Headless != 0;
+			Body->Body->VisibilityBasedAnimTickOption = Headless != 0 && !Body->bKeepServerHandHitboxes
+				? EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered : EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		}
+
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Tick = 0; Tick < Ticks; ++Tick)
+		{
+			for (UIKBodyComponent* Body : Benchmarked)
+			{
+				Body->TickComponent(DeltaTime, LEVELTICK_All, &Body->PrimaryComponentTick);
+				Body->Body->TickAnimation(DeltaTime, false);
+				if (Body->Body->VisibilityBasedAnimTickOption == EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones) Body->Body->RefreshBoneTransforms();
+			}
+		}
+		Microseconds[Headless] = (FPlatformTime::Seconds() - Start) * 1e6 / ((double) Ticks * Benchmarked.Num());
+	}
+
+	for (int32 Index = 0; Index < Benchmarked.Num(); ++Index)
+	{
+		Benchmarked[Index]->RestoreTickSnapshot(Snapshots[Index]);
+	}
+
+	UE_LOG(LogIKBodyComponent, Display, TEXT("Server benchmark, %d bodies, %d ticks: %.2f us per player headless, %.2f us per player with cosmetic IK (-%.0f%%)"),
+		Benchmarked.Num(), Ticks, Microseconds[1], Microseconds[0], Microseconds[0] > 0.0 ? 100.0 * (1.0 - Microseconds[1] / Microseconds[0]) : 0.0);
+}
+
+void UIKBodySubsystem::OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld())
+		return;
+
+	this->ActorTickStartTime = FPlatformTime::Seconds();
+	if (this->BenchmarkFramesLeft <= 0)
+		return;
+
+	// Open and close the hands on alternating frames, every frame is new input
+	TArray<float> Curls;
+	Curls.Init((GFrameCounter & 1) ? 1.0f : 0.0f, (int32) EIKFinger::Thumb + 1);
+	this->BenchmarkInput->SetFingerCurls(ECharacterIKHand::Left, Curls);
+	this->BenchmarkInput->SetFingerCurls(ECharacterIKHand::Right, Curls);
+}
+
+void UIKBodySubsystem::FinishHandInputBenchmark()
+{
+	UE_LOG(LogIKBodyComponent, Display, TEXT("Hand input benchmark, %d bodies: %d poses, input to evaluated pose %.3f ms average, %.3f ms max"),
+		this->BenchmarkBodies.Num(), this->BenchmarkSamples, this->BenchmarkSamples > 0 ? this->BenchmarkLatencySum / this->BenchmarkSamples : 0.0,
+		this->BenchmarkLatencyMax);
+
+	for (const TPair<TWeakObjectPtr<UIKBodyComponent>, TWeakObjectPtr<UObject>>& Benchmarked : this->BenchmarkBodies)
+	{
+		if (Benchmarked.Key.IsValid()) Benchmarked.Key->SetHandInputSource(TScriptInterface<IIKHandInputSource>(Benchmarked.Value.Get()));
+	}
+
+	this->BenchmarkBodies.Reset();
+	this->BenchmarkInput = nullptr;
+}
+
+/*
+ * Groups distant bodies by their mesh, anim class and quantized movement, and lets every group copy the pose of one of its bodies.
+ * Leaders keep leading their group while they're in it, so followers don't switch poses on every update.
+*/
+void UIKBodySubsystem::UpdatePoseSharing(float DeltaSeconds)
+{
+	this->PoseSharingPendingTime += DeltaSeconds;
+	if (this->PoseSharingPendingTime < GIKBodyPoseSharingInterval)
+		return;
+
+	this->PoseSharingPendingTime = 0.0f;
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_PoseSharing);
+
+	TArray<FVector, TInlineAllocator<4>> Views;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* Controller = It->Get();
+		if (Controller == nullptr || !Controller->IsLocalController())
+			continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		Views.Add(ViewLocation);
+	}
+
+	// Without a local view (dedicated servers, headless load tests) nobody sees the difference, and bots there run their full pipeline on purpose
+	TArray<FPoseSharingKey> Keys;
+	TBitArray<> Shareable(false, this->Bodies.Num());
+	Keys.SetNum(this->Bodies.Num());
+	for (int32 Index = 0; Index < this->Bodies.Num(); ++Index)
+	{
+		Shareable[Index] = GIKBodyPoseSharing != 0 && Views.Num() > 0 && this->GetPoseSharingKey(this->Bodies[Index], Views, Keys[Index]);
+	}
+
+	// Current leaders claim their group first, the remaining bodies follow the group's leader or become it
+	TMap<FPoseSharingKey, UIKBodyComponent*> Leaders;
+	for (int32 Index = 0; Index < this->Bodies.Num(); ++Index)
+	{
+		UIKBodyComponent* Body = this->Bodies[Index];
+		if (Shareable[Index] && !Body->IsFollowingPose() && Body->bLeadingPose && !Leaders.Contains(Keys[Index]))
+		{
+			Leaders.Add(Keys[Index], Body);
+		}
+	}
+
+	int32 NumFollowers = 0;
+	for (int32 Index = 0; Index < this->Bodies.Num(); ++Index)
+	{
+		UIKBodyComponent* Body = this->Bodies[Index];
+		if (!Shareable[Index])
+		{
+			Body->SetPoseLeader(nullptr);
+			Body->bLeadingPose = false;
+			continue;
+		}
+
+		UIKBodyComponent*& Leader = Leaders.FindOrAdd(Keys[Index], Body);
+		Body->SetPoseLeader(Leader != Body ? Leader : nullptr);
+		Body->bLeadingPose = Leader == Body;
+		if (Leader != Body) ++NumFollowers;
+	}
+
+	SET_DWORD_STAT(STAT_IKBody_PoseSharingLeaders, Leaders.Num());
+	SET_DWORD_STAT(STAT_IKBody_PoseSharingFollowers, NumFollowers);
+}
+
+bool UIKBodySubsystem::GetPoseSharingKey(UIKBodyComponent* Body, TArrayView<const FVector> Views, FPoseSharingKey& OutKey) const
+{
+	// Bodies that grip, climb, track their hands or play back a stream have a pose of their own
+	if (Body->Body == nullptr || Body->Body->GetSkeletalMeshAsset() == nullptr || Body->PoseReader.IsValid() || Body->IsClimbing()
+		|| Body->TickState.GripState != 0 || Body->HandInputActive[0] || Body->HandInputActive[1])
+		return false;
+
+	// The local player's own body is never shared
+	const APawn* Pawn = Cast<APawn>(Body->GetOwner());
+	if (Pawn != nullptr && Pawn->IsLocallyControlled())
+		return false;
+
+	const FVector Location = Body->Body->GetComponentLocation();
+	for (const FVector& View : Views)
+	{
+		if (FVector::DistSquared(View, Location) < FMath::Square(GIKBodyPoseSharingDistance))
+			return false;
+	}
+
+	// The leader's feet are placed for its own ground, only flat ground looks the same under every follower
+	float GroundHeight;
+	FVector GroundNormal;
+	if (!this->SampleCachedGround(Location, GroundHeight, GroundNormal) || FMath::Abs(GroundHeight - Location.Z) > 50.0f)
+	{
+		FHitResult Hit;
+		const FCollisionQueryParams Params(SCENE_QUERY_STAT(IKBodyPoseSharingGround), false, Body->GetOwner());
+		if (!GetWorld()->LineTraceSingleByChannel(Hit, Location + FVector(0.0f, 0.0f, 50.0f), Location - FVector(0.0f, 0.0f, 50.0f), ECC_Visibility, Params))
+			return false;
+
+		GroundNormal = Hit.ImpactNormal;
+	}
+
+	if (GroundNormal.Z < FMath::Cos(FMath::DegreesToRadians(GIKBodyPoseSharingMaxSlope)))
+		return false;
+
+	// Standing bodies share regardless of their last direction
+	const int32 Speed = FMath::Clamp(FMath::RoundToInt(Body->MovementSpeed / FMath::Max(GIKBodyPoseSharingSpeedStep, 0.01f)), 0, 255);
+	const int32 Directions = FMath::Max(FMath::RoundToInt(360.0f / FMath::Max(GIKBodyPoseSharingDirectionStep, 1.0f)), 1);
+	const int32 Direction = Speed == 0 ? 0 : (FMath::RoundToInt(FRotator::ClampAxis(Body->MovementDirection) / 360.0f * Directions) % Directions);
+
+	OutKey = FPoseSharingKey(Body->Body->GetSkeletalMeshAsset(), Body->Body->GetAnimClass(), (uint16) ((Speed << 8) | Direction));
+	return true;
+}
+
+void UIKBodySubsystem::RegisterBody(UIKBodyComponent* Body)
+{
+	if (Body == nullptr || Body->BodyIndex != INDEX_NONE)
+		return;
+
+	Body->BodyIndex = this->Bodies.Add(Body);
+
+	// The batch reads the head and hands once the pawn and its tracked components have moved, and the body steps after it
+	Body->PrimaryComponentTick.AddPrerequisite(this, this->SolveTickFunction);
+	if (AActor* Owner = Body->GetOwner())
+	{
+		this->SolveTickFunction.AddPrerequisite(Owner, Owner->PrimaryActorTick);
+	}
+
+	USceneComponent* const Sources[] = { Body->Camera, Body->LeftController, Body->RightController };
+	for (USceneComponent* Source : Sources)
+	{
+		if (Source != nullptr) this->SolveTickFunction.AddPrerequisite(Source, Source->PrimaryComponentTick);
+	}
+}
+
+void UIKBodySubsystem::UnregisterBody(UIKBodyComponent* Body)
+{
+	if (Body == nullptr || !this->Bodies.IsValidIndex(Body->BodyIndex) || this->Bodies[Body->BodyIndex] != Body)
+		return;
+
+	// Swap the last body into the free slot so indices stay dense, this frame's batch results stay with the bodies that were solved
+	const int32 Index = Body->BodyIndex;
+	this->Bodies.RemoveAtSwap(Index, 1, false);
+	if (this->Bodies.IsValidIndex(Index)) this->Bodies[Index]->BodyIndex = Index;
+
+	Body->BodyIndex = INDEX_NONE;
+
+	Body->PrimaryComponentTick.RemovePrerequisite(this, this->SolveTickFunction);
+	if (AActor* Owner = Body->GetOwner())
+	{
+		this->SolveTickFunction.RemovePrerequisite(Owner, Owner->PrimaryActorTick);
+	}
+
+	USceneComponent* const Sources[] = { Body->Camera, Body->LeftController, Body->RightController };
+	for (USceneComponent* Source : Sources)
+	{
+		if (Source != nullptr) this->SolveTickFunction.RemovePrerequisite(Source, Source->PrimaryComponentTick);
+	}
+
+	// Followers of a leaving body evaluate their own pose until the next regrouping
+	Body->SetPoseLeader(nullptr);
+	Body->bLeadingPose = false;
+	for (UIKBodyComponent* Follower : this->Bodies)
+	{
+		if (Follower->GetPoseLeader() == Body) Follower->SetPoseLeader(nullptr);
+	}
+}
+
+void UIKBodySubsystem::SolveBodies()
+{
+	SCOPE_CYCLE_COUNTER(STAT_IKBody_SolveBodies);
+	INC_DWORD_STAT_BY(STAT_IKBody_BodiesSolved, this->Bodies.Num());
+
+	this->SolveBatch.SetNum(this->Bodies.Num());
+	for (int32 Index = 0; Index < this->Bodies.Num(); ++Index)
+	{
+		UIKBodyComponent* Body = this->Bodies[Index];
+		Body->GatherSolveInput(this->SolveBatch, Index);
+		Body->SolveBatchIndex = Index;
+		Body->SolveBatchFrame = GFrameCounter;
+	}
+
+	this->SolveBatch.Solve();
+}
+
+void FIKBodySolveTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (this->Subsystem != nullptr) this->Subsystem->SolveBodies();
+}
@@ -0,0 +1,160 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "Subsystems/IKGripRegistry.h"
+
+const FName FIKGripRegistry::GrippableTag = "IKGrippable";
+
+FIntVector FIKGripRegistry::GetCell(const FVector& Location)
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize), 
+		FMath::FloorToInt(Location.Y / CellSize), 
+		FMath::FloorToInt(Location.Z / CellSize));
+}
+
+FBox FIKGripRegistry::GetBounds(const AActor* Actor)
+{
+	// Grippers close on collision, actors without any are found by their location
+	const FBox Bounds = Actor->GetComponentsBoundingBox(false);
+	return Bounds.IsValid ? Bounds : FBox(Actor->GetActorLocation(), Actor->GetActorLocation());
+}
+
+void FIKGripRegistry::Link(AActor* Actor, FEntry& Entry)
+{
+	Entry.Bounds = GetBounds(Actor);
+	Entry.MinCell = GetCell(Entry.Bounds.Min);
+	Entry.MaxCell = GetCell(Entry.Bounds.Max);
+
+	const FIntVector Span = Entry.MaxCell - Entry.MinCell + FIntVector(1);
+	Entry.bLarge = (int64) Span.X * Span.Y * Span.Z > MaxCellsPerActor;
+	if (Entry.bLarge)
+	{
+		this->LargeActors.Add(Actor);
+		return;
+	}
+
+	for (int32 X = Entry.MinCell.X; X <= Entry.MaxCell.X; ++X)
+	{
+		for (int32 Y = Entry.MinCell.Y; Y <= Entry.MaxCell.Y; ++Y)
+		{
+			for (int32 Z = Entry.MinCell.Z; Z <= Entry.MaxCell.Z; ++Z)
+			{
+				this->Cells.FindOrAdd(FIntVector(X, Y, Z)).Add(Actor);
+			}
+		}
+	}
+}
+
+void FIKGripRegistry::Unlink(AActor* Actor, const FEntry& Entry)
+{
+	if (Entry.bLarge)
+	{
+		this->LargeActors.RemoveSwap(Actor, false);
+		return;
+	}
+
+	for (int32 X = Entry.MinCell.X; X <= Entry.MaxCell.X; ++X)
+	{
+		for (int32 Y = Entry.MinCell.Y; Y <= Entry.MaxCell.Y; ++Y)
+		{
+			for (int32 Z = Entry.MinCell.Z; Z <= Entry.MaxCell.Z; ++Z)
+			{
+				const FIntVector Cell(X, Y, Z);
+				if (TArray<TWeakObjectPtr<AActor>>* Actors = this->Cells.Find(Cell))
+				{
+					Actors->RemoveSwap(Actor, false);
+					if (Actors->Num() == 0) this->Cells.Remove(Cell);
+				}
+			}
+		}
+	}
+}
+
+void FIKGripRegistry::Add(AActor* Actor)
+{
+	if (Actor == nullptr || this->Entries.Contains(Actor))
+		return;
+
+	this->Link(Actor, this->Entries.Add(Actor));
+}
+
+void FIKGripRegistry::Remove(AActor* Actor)
+{
+	FEntry Entry;
+	if (this->Entries.RemoveAndCopyValue(Actor, Entry))
+	{
+		this->Unlink(Actor, Entry);
+	}
+}
+
+void FIKGripRegistry::Update(AActor* Actor)
+{
+	FEntry* Entry = this->Entries.Find(Actor);
+	if (Entry == nullptr)
+		return;
+
+	// Actors moving within their cells only update their bounds
+	const FBox Bounds = GetBounds(Actor);
+	if (!Entry->bLarge && GetCell(Bounds.Min) == Entry->MinCell && GetCell(Bounds.Max) == Entry->MaxCell)
+	{
+		Entry->Bounds = Bounds;
+		return;
+	}
+
+	this->Unlink(Actor, *Entry);
+	this->Link(Actor, *Entry);
+}
+
+AActor* FIKGripRegistry::FindNearest(const FVector& Location, float Radius) const
+{
+	const FIntVector Min = GetCell(Location - FVector(Radius));
+	const FIntVector Max = GetCell(Location + FVector(Radius));
+
+	AActor* Nearest = nullptr;
+	double NearestDistanceSquared = FMath::Square(Radius);
+
+	// An actor spanning several of the visited cells is measured once per cell, which is cheaper than deduplicating
+	auto Measure = [&](const TWeakObjectPtr<AActor>& Actor)
+	{
+		const FEntry* Entry = Actor.IsValid() ? this->Entries.Find(Actor) : nullptr;
+		if (Entry == nullptr) return;
+
+		const double DistanceSquared = Entry->Bounds.ComputeSquaredDistanceToPoint(Location);
+		if (DistanceSquared <= NearestDistanceSquared)
+		{
+			Nearest = Actor.Get();
+			NearestDistanceSquared = DistanceSquared;
+		}
+	};
+
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+			{
+				const TArray<TWeakObjectPtr<AActor>>* Actors = this->Cells.Find(FIntVector(X, Y, Z));
+				if (Actors == nullptr) continue;
+
+				for (const TWeakObjectPtr<AActor>& Actor : *Actors)
+				{
+					Measure(Actor);
+				}
+			}
+		}
+	}
+
+	for (const TWeakObjectPtr<AActor>& Actor : this->LargeActors)
+	{
+		Measure(Actor);
+	}
+
+	return Nearest;
+}
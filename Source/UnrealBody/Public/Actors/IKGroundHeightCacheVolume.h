@@ -0,0 +1,53 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Components/BoxComponent.h"
+#include "Data/IKGroundHeightCache.h"
+
+#include "IKGroundHeightCacheVolume.generated.h"
+
+/**
+ * Place in a level and scale the box over the walkable area to bake a ground height cache for foot IK.
+ * The cache streams in with the level and is handed to the IK body subsystem once loaded.
+ */
+UCLASS()
+class UNREALBODY_API AIKGroundHeightCacheVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AIKGroundHeightCacheVolume();
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IKBody | Ground")
+		UBoxComponent* Bounds = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "IKBody | Ground")
+		TSoftObjectPtr<UIKGroundHeightCache> Cache;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "IKBody | Ground")
+		bool bBakeOnLoad = false
+		UMETA(Tooltip = "Bake the cache when the level starts if it hasn't been baked in the editor. Without a cache asset a transient one is baked.");
+
+	/** Bakes the static collision inside the bounds into the cache asset */
+	UFUNCTION(CallInEditor, BlueprintCallable, Category = "IKBody | Ground")
+		void BakeGroundCache();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	UPROPERTY(Transient)
+		UIKGroundHeightCache* LoadedCache = nullptr;
+
+	void OnCacheLoaded();
+};
@@ -0,0 +1,130 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BoneContainer.h"
+#include "BoneControllers/AnimNode_SkeletalControlBase.h"
+
+#include "AnimNode_IKFootPlacement.generated.h"
+
+/** Bone setup and runtime state of a single leg for the foot placement node */
+USTRUCT(BlueprintInternalUseOnly)
+struct UNREALBODY_API FIKFootPlacementLeg
+{
+	GENERATED_BODY()
+
+	/** Foot bone, its parent and grandparent are used as the IK chain (calf, thigh) */
+	UPROPERTY(EditAnywhere, Category = "Bones")
+		FBoneReference FootBone;
+
+	FCompactPoseBoneIndex FootIndex = FCompactPoseBoneIndex(INDEX_NONE);
+	FCompactPoseBoneIndex CalfIndex = FCompactPoseBoneIndex(INDEX_NONE);
+	FCompactPoseBoneIndex ThighIndex = FCompactPoseBoneIndex(INDEX_NONE);
+
+	// Ground sampled this update (component space)
+	bool bGroundHit = false;
+	float TargetOffset = 0.0f;
+	FQuat TargetRotation = FQuat::Identity;
+
+	// Smoothed results
+	float Offset = 0.0f;
+	FQuat Rotation = FQuat::Identity;
+
+	// Foot locking (world space, so the foot stays planted while the body moves)
+	bool bLocked = false;
+	float LockAlpha = 0.0f;
+	FVector LockedLocation = FVector::ZeroVector;
+	FVector LastLocation = FVector::ZeroVector;
+};
+
+/**
+ * Foot placement node.
+ * Samples the heel and toe of both feet with a single batched ground query per avatar, lowers the pelvis so both feet
+ * can reach the ground, locks planted feet in place and solves both legs with two-bone IK. Runs on animation worker threads.
+ */
+USTRUCT(BlueprintInternalUseOnly)
+struct UNREALBODY_API FAnimNode_IKFootPlacement : public FAnimNode_SkeletalControlBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Bones")
+		FBoneReference PelvisBone;
+
+	UPROPERTY(EditAnywhere, Category = "Bones")
+		FIKFootPlacementLeg LeftLeg;
+
+	UPROPERTY(EditAnywhere, Category = "Bones")
+		FIKFootPlacementLeg RightLeg;
+
+	/** Direction the feet point in, in component space. The mannequin faces +Y. */
+	UPROPERTY(EditAnywhere, Category = "Bones")
+		FVector FootForwardAxis = FVector(0.0f, 1.0f, 0.0f);
+
+	UPROPERTY(EditAnywhere, Category = "Trace")
+		TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Units above the root the ground is sampled from, limits the height of steps */
+	UPROPERTY(EditAnywhere, Category = "Trace")
+		float TraceHeight = 60.0f;
+
+	/** Units below the root the ground is sampled to, limits how far the pelvis can drop */
+	UPROPERTY(EditAnywhere, Category = "Trace")
+		float TraceDepth = 40.0f;
+
+	/** Distance from the foot bone to the toe sample */
+	UPROPERTY(EditAnywhere, Category = "Trace")
+		float ToeLength = 15.0f;
+
+	/** Distance from the foot bone to the heel sample */
+	UPROPERTY(EditAnywhere, Category = "Trace")
+		float HeelLength = 5.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Settings")
+		float MaxPelvisOffset = 40.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Settings")
+		float FootInterpSpeed = 15.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Settings")
+		float PelvisInterpSpeed = 10.0f;
+
+	/** Feet moving slower than this (units per second) are considered planted and locked in place */
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (PinHiddenByDefault))
+		float LockSpeedThreshold = 15.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (PinHiddenByDefault))
+		float LockBlendSpeed = 10.0f;
+
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (PinHiddenByDefault))
+		bool bEnableFootLocking = true;
+
+	// FAnimNode_Base interface
+	virtual void Initialize_AnyThread(const FAnimationInitializeContext& Context) override;
+	virtual void GatherDebugData(FNodeDebugData& DebugData) override;
+
+	// FAnimNode_SkeletalControlBase interface
+	virtual void UpdateInternal(const FAnimationUpdateContext& Context) override;
+	virtual void EvaluateSkeletalControl_AnyThread(FComponentSpacePoseContext& Output, TArray<FBoneTransform>& OutBoneTransforms) override;
+	virtual bool IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones) override;
+
+private:
+	// FAnimNode_SkeletalControlBase interface
+	virtual void InitializeBoneReferences(const FBoneContainer& RequiredBones) override;
+
+	/** Runs the batched ground query for both feet and stores the targets on the legs */
+	void SampleGround(FComponentSpacePoseContext& Output, const FTransform& LeftFoot, const FTransform& RightFoot);
+
+	/** Smooths and locks a leg, then solves it towards the ground */
+	void SolveLeg(FIKFootPlacementLeg& Leg, FCSPose<FCompactPose>& Pose, const FTransform& ComponentTransform, TArray<FBoneTransform>& OutBoneTransforms);
+
+	float DeltaTime = 0.0f;
+	float PelvisOffset = 0.0f;
+	bool bFirstUpdate = true;
+};
@@ -32,6 +32,15 @@ public:
 
 	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
 
+	/** Anim Graph - Finger IK, alpha of a joint of the body's skeleton profile, as of this animation update */
+	UFUNCTION(BlueprintPure, Category = "Anim Graph - Finger IK", meta = (BlueprintThreadSafe))
+	float GetFingerJointAlpha(int32 Joint) const;
+
+	const FAnimGraphFingerIK& GetFingerIKValues() const { return this->FingerIKValues; }
+
+	/** Bytes of the finger joint alphas copied into this anim instance every update */
+	SIZE_T GetFingerAlphasAllocatedSize() const { return this->FingerIKValues.BlendMap.GetAllocatedSize() + this->FingerJointAlphas.GetAllocatedSize(); }
+
 private:
 
 	void UpdateFootIK();
@@ -48,7 +57,17 @@ private:
 	void TraceFoot(FVector Foot, FVector* ResultLocation,
 		FRotator* ResultRotation, UWorld* World, FCollisionQueryParams* Params);
 
+	// Time since the last foot trace, used while the body's work is reduced by the animation budget
+	float FootIKPendingTime = 0.0f;
+
+	// Joint alphas of the body, copied on the game thread so worker threads don't read them while the body writes them
+	TArray<float> FingerJointAlphas;
+
 protected:
+	/** Skip the per-foot traces when the anim graph uses the native IK Foot Placement node instead */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Settings")
+	bool bUseNativeFootPlacement = false;
+
 	/** References */
 	UPROPERTY(BlueprintReadOnly)
 	UIKBodyComponent* BodyComponent = nullptr;
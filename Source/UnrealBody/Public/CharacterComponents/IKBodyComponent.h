@@ -14,18 +14,67 @@
 #include "Camera/CameraComponent.h"
 #include "Components/ActorComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "WorldCollision.h"
 #include "Library/CharacterStateLibrary.h"
 #include "Library/AnimationStructLibrary.h"
+#include "Data/IKFingerPoseLibrary.h"
+#include "Data/IKBodySkeletonProfile.h"
+#include "Input/IKHandInputSource.h"
+#include "Input/IKBodyInputSource.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "Solver/IKBodyBatchSolver.h"
+#include "Solver/IKClimbSolver.h"
+#include "Replay/IKPoseStream.h"
 
 #include "IKBodyComponent.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogIKBodyComponent, Log, All);
 
+/**
+ * Body state read and written every tick, packed into a single cache line and aligned to start one.
+ * Only XY and yaw of the body and the last step's camera are used, locations are in the same float precision as the batched solve.
+ */
+struct alignas(PLATFORM_CACHE_LINE_SIZE) FIKBodyTickState
+{
+	// Body position (XY only)
+	FVector2f CurrentLocation = FVector2f::ZeroVector;
+	FVector2f TargetLocation = FVector2f::ZeroVector;
+
+	// Unobstructed target of the last step, placement sweeps towards it
+	FVector2f PlacementTarget = FVector2f::ZeroVector;
+
+	// Camera when the body last stepped
+	FVector2f LastCameraLocation = FVector2f::ZeroVector;
+	FVector3f LastCameraForward = FVector3f::ForwardVector;
+	float LastCameraYaw = 0.0f;
+
+	// Body rotation (yaw only)
+	float CurrentYaw = 0.0f;
+	float TargetYaw = 0.0f;
+
+	float FingerIKPendingTime = 0.0f;
+
+	// Grip state bits, indexed by ECharacterIKHand. All a headless server keeps of the hand pose.
+	uint8 GripState = 0;
+
+	ECharacterState CharacterState = ECharacterState::Idle;
+
+	// Dedicated server without cosmetic IK
+	bool bHeadless = false;
+
+	// Animation budget asks to reduce work
+	bool bWorkReduced = false;
+};
+
+static_assert(sizeof(FIKBodyTickState) == PLATFORM_CACHE_LINE_SIZE && alignof(FIKBodyTickState) == PLATFORM_CACHE_LINE_SIZE, "The tick state of a body should occupy exactly one cache line");
+
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class UNREALBODY_API UIKBodyComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+	friend class UIKBodySubsystem;
+
 public:
 	// Sets default values for this component's properties
 	UIKBodyComponent();
@@ -50,6 +99,104 @@ public:
 		UMETA(Tooltip = "Increase or decrease the speed of the character during movement. Use this to avoid the character lagging behind over longer distances.");
 
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Placement")
+		bool bCollisionAwarePlacement = false
+		UMETA(Tooltip = "Sweep the body from the head to its target whenever it steps or turns, so it stops at walls instead of clipping into them, and push it out of walls it still overlaps, e.g. when leaning into one.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Placement")
+		TEnumAsByte<ECollisionChannel> PlacementChannel = ECC_Visibility;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Placement")
+		float PlacementRadius = 15.0f
+		UMETA(Tooltip = "Radius of the capsule swept along the torso when placing the body.");
+
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Climbing")
+		float ClimbArmLength = 65.0f
+		UMETA(Tooltip = "Reach from a shoulder to its gripped hand while climbing. The body is pulled up when the head is further below the grips than this.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Climbing")
+		float ClimbShoulderWidth = 36.0f
+		UMETA(Tooltip = "Distance between the shoulders the body hangs from while climbing.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Server")
+		bool bHeadlessOnDedicatedServer = false
+		UMETA(Tooltip = "On dedicated servers only move the body root and keep grip states, skipping finger interpolation, foot traces and head/arm IK. Hitboxes attached to hand or finger bones stop following the hands on the server, unless Keep Server Hand Hitboxes is set.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Server")
+		bool bHeadlessWithBodyInputSource = false
+		UMETA(Tooltip = "Also run headless on dedicated servers while a body input source drives the body. Off so bot bodies run the full finger, foot, head and arm IK in server load tests.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Server")
+		bool bKeepServerHandHitboxes = false
+		UMETA(Tooltip = "Keep pooled finger hitboxes (and bone updates) for gripping hands on headless servers, for gameplay that depends on finger collision.");
+
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Budget")
+		bool bUseAnimationBudget = false
+		UMETA(Tooltip = "Register the body with the animation budget allocator. Requires the body to be a SkeletalMeshComponentBudgeted and the allocator to be enabled by the project (a.Budget.Enabled 1). The budget is set with IKBody.AnimBudgetMs.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Budget")
+		float BudgetSignificanceDistance = 1500.0f
+		UMETA(Tooltip = "Distance from the nearest local view at which a remote body's significance is halved.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Budget")
+		float ReducedWorkInterval = 0.1f
+		UMETA(Tooltip = "Seconds between finger and foot IK updates while the budget allocator asks this body to reduce work.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Budget")
+		float GovernedBodyTickInterval = 0.033f
+		UMETA(Tooltip = "Seconds between body ticks while the frame time governor has reduced IK quality to its lowest level.");
+
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Grip")
+		bool bPrewarmGrips = true
+		UMETA(Tooltip = "Look for registered grippable actors around the hands and prepare the grip while a hand approaches one, so the fingers start the grip close to their final pose.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Grip")
+		float GripPrewarmInterval = 0.1f
+		UMETA(Tooltip = "Seconds between grippable queries around the hands.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Grip", meta = (ClampMax = "50"))
+		float GripPrewarmRadius = 40.0f
+		UMETA(Tooltip = "Distance from a controller to a grippable actor's bounds at which the hand is considered approaching it.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Grip")
+		float GripPrewarmTolerance = 2.0f
+		UMETA(Tooltip = "Distance the hand may have moved relative to the target since the grip was last prepared, for a grip to start from that pose instead of measuring it again.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Grip")
+		float GripCurlReach = 8.0f
+		UMETA(Tooltip = "Distance a finger joint travels from open to fully curled. Prepared grips curl each joint by its distance to the target over this reach.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Grip")
+		bool bAsyncFingerContacts = true
+		UMETA(Tooltip = "Check finger contacts with async overlap queries that run off the game thread. A contact is then found up to one frame late and the finger moves back to where it touched. Disable to check overlaps on the game thread without delay.");
+
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Replay", meta = (ClampMin = "1"))
+		float PoseRecordingFrameRate = 30.0f
+		UMETA(Tooltip = "Frames per second recorded into pose streams.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Replay", meta = (ClampMin = "1"))
+		int32 PoseRecordingFramesPerChunk = 30
+		UMETA(Tooltip = "Frames per keyframed chunk. Longer chunks are smaller on disk, shorter chunks are faster to seek into.");
+
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Late Update")
+		bool bLateUpdate = true
+		UMETA(Tooltip = "Right before rendering, move the evaluated hand and head bones by how far the tracked controllers and HMD moved since the animation was updated. Only applies to the body of a locally controlled pawn.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Late Update")
+		FName LeftHandBone = "hand_l";
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Late Update")
+		FName RightHandBone = "hand_r";
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Settings | Late Update")
+		FName HeadBone = "head";
+
+
 	/*
 	 * Movement Values, replicated (server changes are sent to clients)
 	*/
@@ -102,19 +249,67 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "IKBody")
 		void StopFingerIK(ECharacterIKHand Hand);
 
+	/** True on dedicated servers running without cosmetic IK */
+	UFUNCTION(BlueprintPure, Category = "IKBody")
+		bool IsHeadless() const { return this->TickState.bHeadless; }
+
+	/** True while the animation budget allocator asks this body to reduce work */
+	UFUNCTION(BlueprintPure, Category = "IKBody")
+		bool IsWorkReduced() const { return this->TickState.bWorkReduced; }
+
+	/** True while foot IK should trace less often, because of the budget allocator or the frame time governor */
+	UFUNCTION(BlueprintPure, Category = "IKBody")
+		bool IsFootWorkReduced() const;
+
+	/** Grippable actor the hand is approaching and has a prepared grip for, if any */
+	UFUNCTION(BlueprintPure, Category = "IKBody")
+		AActor* GetApproachedGrippable(ECharacterIKHand Hand) const { return this->GripPrewarm[(uint8) Hand].Target.Get(); }
+
+	UFUNCTION(BlueprintPure, Category = "IKBody")
+		bool IsGripping(ECharacterIKHand Hand) const { return (this->TickState.GripState & (1 << (uint8) Hand)) != 0; }
+
+	UFUNCTION(BlueprintCallable, Category = "IKBody")
+		void BeginTeleport() { this->EndClimbing(); this->TickState.CharacterState = ECharacterState::Teleporting; };
+
 	UFUNCTION(BlueprintCallable, Category = "IKBody")
-		void BeginTeleport() { this->IsTeleporting = true; };
+		void EndTeleport() { if (this->TickState.CharacterState == ECharacterState::Teleporting) this->TickState.CharacterState = ECharacterState::Idle; };
 
+	/** Hangs the body from the hands gripping with Start Finger IK, below the head as far as the arms reach, instead of walking after the head */
 	UFUNCTION(BlueprintCallable, Category = "IKBody")
-		void EndTeleport() { this->IsTeleporting = false; };
+		void BeginClimbing();
+
+	/** Returns to walking from where the body let go */
+	UFUNCTION(BlueprintCallable, Category = "IKBody")
+		void EndClimbing();
+
+	UFUNCTION(BlueprintPure, Category = "IKBody")
+		ECharacterState GetCharacterState() const { return this->TickState.CharacterState; }
+
+	bool IsClimbing() const { return this->TickState.CharacterState == ECharacterState::Climbing; }
 
 	/*
-		Finger IK maps
+		Finger IK
 	*/
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "IKBody | Fingers")
+		UIKBodySkeletonProfile* SkeletonProfile = nullptr
+		UMETA(Tooltip = "Hands, fingers and joints of the body. Uses the mannequin layout when empty. Joints with a pooled hitbox only have a hitbox while their hand is gripping.");
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IKBody | Fingers")
-		TMap<EFingerBone, UCapsuleComponent*> FingerHitboxes;
+		UIKFingerPoseLibrary* FingerPoseLibrary = nullptr;
+
+	/** Replaces the skeleton profile at runtime, rebuilding the joint tables */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Fingers")
+		void SetSkeletonProfile(UIKBodySkeletonProfile* Profile);
+
+	/** Assigns hitboxes to the joints of the skeleton profile, in the order they are declared (left hand first) */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Fingers")
+		void SetHitBoxes(const TArray<UCapsuleComponent*>& Hitboxes);
 
+	/** Assigns the hitbox of a single joint by bone name */
 	UFUNCTION(BlueprintCallable, Category = "IKBody | Fingers")
+		void SetJointHitBox(FName Bone, UCapsuleComponent* Hitbox);
+
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Fingers", meta = (DeprecatedFunction, DeprecationMessage = "Use a skeleton profile with pooled hitboxes, or SetHitBoxes."))
 		void SetAllHitBoxes(
 			UCapsuleComponent* index_01_l,
 			UCapsuleComponent* index_02_l,
@@ -148,47 +343,282 @@ public:
 			UCapsuleComponent* thumb_03_r
 		);
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IKBody | Fingers", meta = (DeprecatedProperty, DeprecationMessage = "Use a skeleton profile with pooled hitboxes, or SetHitBoxes. Hitboxes in this map are assigned to the joint of the same bone when the joint tables are built."))
+		TMap<EFingerBone, UCapsuleComponent*> FingerHitboxes;
+
+	UE_DEPRECATED(5.1, "No longer updated, read GetJointAlphas with GetJointTables, or the anim instance's GetFingerIKValues.")
 	FAnimGraphFingerIK FingerIKValues = FAnimGraphFingerIK();
 
+	/** Sets the alphas of a finger's joints from a single curl value using the finger pose library */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Fingers")
+		void SetFingerCurl(ECharacterIKHand Hand, EIKFinger Finger, float Curl);
+
+	/** Joint tables built from the skeleton profile */
+	const FIKFingerJointTables& GetJointTables() { this->EnsureJointTables(); return this->JointTables; }
+
+	/** Current alpha of every joint, indexed like the joint tables */
+	const TArray<float>& GetJointAlphas() const { return this->JointAlphas; }
+
+	/*
+		Hand input
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IKBody | Input")
+		float MaxJointCurlAngle = 90.0f
+		UMETA(Tooltip = "Joint rotation in degrees that is considered fully curled when hand input provides joint rotations.");
+
+	/** Drives the head and hands from an input source instead of the camera and controllers, e.g. a bot driver. None returns to the camera and controllers. */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Input")
+		void SetBodyInputSource(TScriptInterface<IIKBodyInputSource> Source);
+
+	/** Head and hand poses of this frame, from the body input source or the camera and controllers */
+	const FIKTrackedPoses& GetTrackedPoses() const;
+
+	/** Whether there is a camera or a body input source to drive the body */
+	bool HasTrackedInput() const { return this->Camera != nullptr || this->BodyInputSource.GetObject() != nullptr; }
+
+	/** Drives the fingers from a hand input source instead of collision, for hands the source is tracking */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Input")
+		void SetHandInputSource(TScriptInterface<IIKHandInputSource> Source);
+
+	/** Time in milliseconds between the hand input being produced and the body's pose being evaluated with it */
+	UFUNCTION(BlueprintPure, Category = "IKBody | Input")
+		float GetHandInputLatency() const { return this->HandInputLatency; }
+
+	/** Samples the newest hand input into the finger joints, called right before the body's animation is updated */
+	void SampleHandInput();
+
+	/** Measures the hand input latency once the pose is evaluated, returns false if no hand input was sampled this frame */
+	bool MeasureHandInputLatency();
+
+	/** Time in milliseconds between the animation sampling the tracked poses and the late update correcting them */
+	UFUNCTION(BlueprintPure, Category = "IKBody | Input")
+		float GetLateUpdateLatency() const { return this->LateUpdateLatency; }
+
+	/** Stores the controller and camera transforms the animation is updated with, called from the anim instance */
+	void LatchTrackedPoses();
+
+	/** Corrects the evaluated hand and head bones with the newest tracked poses, called once all animation is done */
+	void ApplyLateUpdate();
+
+	/*
+		Pose streams
+	*/
+	/** Records the body's root, head and hand targets and finger alphas to a pose stream. Relative paths are in Saved/PoseStreams. */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Replay")
+		bool StartPoseRecording(const FString& Filename);
+
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Replay")
+		void StopPoseRecording();
+
+	/** Poses the body from a pose stream instead of the camera and controllers, until stopped */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Replay")
+		bool StartPosePlayback(const FString& Filename);
+
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Replay")
+		void StopPosePlayback();
+
+	/** Jumps to a time in seconds in the pose stream being played back */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Replay")
+		void SeekPosePlayback(float Time) { this->PosePlaybackTime = Time; }
+
+	UFUNCTION(BlueprintPure, Category = "IKBody | Replay")
+		bool IsPlayingBackPose() const { return this->PoseReader.IsValid(); }
+
+	/** Pose being played back this frame, nullptr when the body follows the camera and controllers */
+	const FIKPoseFrame* GetPlaybackFrame() const { return this->PoseReader.IsValid() ? &this->PoseFrame : nullptr; }
+
+	/** Head IK target solved with the body this frame, returns false if the body hasn't been solved yet this frame */
+	bool GetSolvedHeadLocation(FVector& OutLocation) const;
+
+	/** Whether this body copies the pose of a distant body in the same movement state instead of evaluating its own, see IKBody.PoseSharing */
+	UFUNCTION(BlueprintPure, Category = "IKBody | Pose Sharing")
+		bool IsFollowingPose() const { return this->PoseLeader.IsValid(); }
+
+	UIKBodyComponent* GetPoseLeader() const { return this->PoseLeader.Get(); }
+
+	/** Follows the pose of another body with this body's own root transform, or evaluates its own pose again for none */
+	void SetPoseLeader(UIKBodyComponent* Leader);
+
+	/** Adds the bytes used by this body (and its anim instance) per part to a memory report */
+	void AppendMemoryReport(TArray<TPair<const TCHAR*, SIZE_T>>& OutParts) const;
+
+	/** Writes this body's camera and step state into a solve batch */
+	void GatherSolveInput(FIKBodySolveBatch& Batch, int32 Index) const;
+
 	// Movement variables
 	float MovementDirection = 0.0f;
 	float MovementSpeed = 0.0f;
 	float FInterpSpeed = 0.0f;
 
 private:
-	FTransform LastCameraPosition = FTransform();
+	// Read and written every tick, see FIKBodyTickState
+	FIKBodyTickState TickState;
+
+	// Pose sharing, assigned by the subsystem
+	TWeakObjectPtr<UIKBodyComponent> PoseLeader;
+	bool bLeadingPose = false;
+
+	// Batched solve, the batch index is where the body was solved in the frame of the batch
+	int32 BodyIndex = INDEX_NONE;
+	int32 SolveBatchIndex = INDEX_NONE;
+	uint64 SolveBatchFrame = MAX_uint64;
+	uint64 LastSolveFrame = MAX_uint64;
+	FIKBodySolveBatch SingleBatch;
+	FVector HeadTargetLocation = FVector();
+
+	void SweepBodyPlacement(const FVector& HeadLocation);
+
+	// Climbing, the solver keeps its solution between ticks
+	FIKClimbSolver ClimbSolver;
+	void TickClimbing();
+
+	// Finger joint tables and per-joint state, indexed by joint
+	FIKFingerJointTables JointTables;
+	TArray<float> JointAlphas;
+	TBitArray<> JointFinished;
+	TBitArray<> JointHitboxPooled;
+	bool bJointTablesBuilt = false;
 
-	// Body Position (XY only!)
-	FVector BodyCurrentLocation = FVector();
-	FVector BodyTargetLocation = FVector();
+	// Async finger contacts, a joint has at most one query in flight. Results of a hand's previous grip are told apart by its generation.
+	TBitArray<> JointContactPending;
+	TBitArray<> JointContact;
+	TArray<float> JointContactAlphas;
+	uint16 ContactGeneration[2] = { 0, 0 };
+	FOverlapDelegate FingerContactDelegate;
 
-	// Body Rotation (Yaw only!)
-	FRotator BodyTargetRotation = FRotator();
-	FRotator BodyCurrentRotation = FRotator();
+	void OnFingerContact(const FTraceHandle& Handle, FOverlapDatum& Datum);
+
+	UPROPERTY(Transient)
+		TArray<UCapsuleComponent*> JointHitboxes;
+
+	// Body input, sampled once per frame
+	UPROPERTY(Transient)
+		TScriptInterface<IIKBodyInputSource> BodyInputSource;
+
+	mutable FIKTrackedPoses TrackedPoses;
+	mutable uint64 TrackedPosesFrame = MAX_uint64;
+
+	void InitializeBody();
+
+	// Hand input
+	UPROPERTY(Transient)
+		TScriptInterface<IIKHandInputSource> HandInputSource;
+
+	FIKHandInputFrame HandInputFrame;
+	bool HandInputActive[2] = { false, false };
+	float HandInputLatency = 0.0f;
+
+	// Oldest input the fingers were posed with this frame
+	double HandInputSampleTime = 0.0;
+	uint64 HandInputSampleFrame = MAX_uint64;
 
-	// Finger States
-	FFingerStateMap FingerStates = FFingerStateMap();
-	
 	// Grip States
 	AActor* LeftGrip = nullptr;
 	AActor* RightGrip = nullptr;
 
-	// Teleport
-	bool IsTeleporting = false;
-
-	// Movement Direction Util
-	float GetMovementDirection(FTransform* First, FTransform* Second);
-
-	// Body Offset Util
-	void SetBodyTargetPosition(FTransform* CameraTransform);
+	// Animation budget
+	UPROPERTY(Transient)
+		USkeletalMeshComponentBudgeted* BudgetedBody = nullptr;
+
+	float DefaultTickInterval = 0.0f;
+
+	// Grip prepared while a hand approaches a grippable actor, indexed by ECharacterIKHand
+	struct FIKGripPrewarm
+	{
+		TWeakObjectPtr<AActor> Target;
+		TArray<float> Alphas;
+
+		// Where the hand was relative to the target when the alphas were measured
+		FVector HandInTarget = FVector::ZeroVector;
+
+		// Pooled hitboxes were acquired for the approach, released once the hand moves away even if the target is gone
+		bool bHitboxesAcquired = false;
+	};
+
+	FIKGripPrewarm GripPrewarm[2];
+	float GripPrewarmPendingTime = 0.0f;
+
+	void TickGripPrewarm();
+	void PrewarmGrip(ECharacterIKHand Hand, AActor* Target);
+	FVector GetHandInTarget(ECharacterIKHand Hand, const AActor* Target) const;
+
+	// What a tick changes on a live body, saved and restored around the ticks of IKBody.Server.Benchmark
+	struct FIKBodyTickSnapshot
+	{
+		FIKBodyTickState TickState;
+		FTransform BodyTransform;
+		EVisibilityBasedAnimTickOption AnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		float TickInterval = 0.0f;
+		FVector HeadTargetLocation = FVector::ZeroVector;
+		float MovementDirection = 0.0f;
+		float MovementSpeed = 0.0f;
+		uint64 LastSolveFrame = MAX_uint64;
+		FIKClimbSolver ClimbSolver;
+		TArray<float> JointAlphas;
+		TBitArray<> JointFinished;
+		TBitArray<> JointContact;
+		TArray<float> JointContactAlphas;
+		FIKGripPrewarm GripPrewarm[2];
+		float GripPrewarmPendingTime = 0.0f;
+	};
+
+	void SaveTickSnapshot(FIKBodyTickSnapshot& OutSnapshot) const;
+	void RestoreTickSnapshot(const FIKBodyTickSnapshot& Snapshot);
+
+	// Headless mode follows the net mode and the body input source, the mesh's own tick option is restored when leaving it
+	EVisibilityBasedAnimTickOption DefaultAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	void UpdateHeadless();
+
+	void RegisterWithAnimationBudget();
+	void UpdateBudgetSignificance();
+	void OnReduceWork(USkeletalMeshComponentBudgeted* Component, bool bReduce) { this->TickState.bWorkReduced = bReduce; }
+
+	// Late update, indexed by ELateUpdateTarget
+	enum ELateUpdateTarget { LeftHandTarget, RightHandTarget, HeadTarget, NumLateUpdateTargets };
+	FTransform LatchedPoses[NumLateUpdateTargets];
+	TArray<int32> LateUpdateBones[NumLateUpdateTargets];
+	TWeakObjectPtr<USkeletalMesh> LateUpdateMesh;
+	uint64 LatchFrame = MAX_uint64;
+	double LatchTime = 0.0;
+	float LateUpdateLatency = 0.0f;
+
+	USceneComponent* GetLateUpdateSource(int32 Target) const;
+	FTransform GetNewestTrackedPose(int32 Target) const;
+	void CacheLateUpdateBones();
+
+	// Pose streams, the frame is reused for recording and playback
+	TUniquePtr<FIKPoseStreamWriter> PoseWriter;
+	TUniquePtr<FIKPoseStreamReader> PoseReader;
+	FIKPoseFrame PoseFrame;
+	float PoseRecordPendingTime = 0.0f;
+	float PosePlaybackTime = 0.0f;
+
+	void RecordPose(float DeltaTime);
+	void TickPosePlayback(float DeltaTime);
 
 	// Finger reset
 	void ResetHandFingers(ECharacterIKHand Hand);
 
+	// Hitbox pool, capsules not currently attached to a gripping hand
+	UPROPERTY(Transient)
+		TArray<UCapsuleComponent*> HitboxPool;
+
+	// Pooled hitbox activation
+	void AcquireHandHitboxes(ECharacterIKHand Hand);
+	void ReleaseHandHitboxes(ECharacterIKHand Hand);
+
+	// Sets a finger's joint alphas from a curl using the finger pose library
+	void ApplyFingerCurl(const FIKFingerRange& Finger, float Curl);
+
+	// Builds the joint tables from the skeleton profile if that hasn't happened yet
+	void EnsureJointTables();
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
@@ -0,0 +1,136 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Library/AnimationStructLibrary.h"
+#include "Library/CharacterStateLibrary.h"
+
+#include "IKBodySkeletonProfile.generated.h"
+
+/** A single tracked finger joint and its optional pooled hitbox */
+USTRUCT(BlueprintType)
+struct FIKFingerJointDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		FName Bone = NAME_None;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		bool bPooledHitbox = true
+		UMETA(Tooltip = "Create a hitbox for this joint from the component's pool while the hand is gripping.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bPooledHitbox"))
+		FName Socket = NAME_None
+		UMETA(Tooltip = "Bone or socket the hitbox is attached to, uses the joint bone when empty.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bPooledHitbox"))
+		FTransform HitboxTransform = FTransform();
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bPooledHitbox"))
+		float HitboxRadius = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "bPooledHitbox"))
+		float HitboxHalfHeight = 2.0f;
+};
+
+/** A finger, its joints are listed from the palm outwards */
+USTRUCT(BlueprintType)
+struct FIKFingerDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		EIKFinger Finger = EIKFinger::Index
+		UMETA(Tooltip = "Used to look up curl curves in the finger pose library.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		TArray<FIKFingerJointDefinition> Joints;
+};
+
+USTRUCT(BlueprintType)
+struct FIKHandDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		ECharacterIKHand Hand = ECharacterIKHand::Left;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		TArray<FIKFingerDefinition> Fingers;
+};
+
+/** Cold per-joint data, only read when hitboxes are (de)activated */
+struct FIKFingerJointInfo
+{
+	FName Bone = NAME_None;
+	FName Socket = NAME_None;
+	FTransform HitboxTransform = FTransform::Identity;
+	float HitboxRadius = 0.0f;
+	float HitboxHalfHeight = 0.0f;
+	bool bPooledHitbox = false;
+
+	/** Matching EFingerBone for the anim graph blend map, or INDEX_NONE when the bone isn't part of the mannequin */
+	int8 BlendMapBone = INDEX_NONE;
+};
+
+/** A contiguous range of joints */
+struct FIKJointRange
+{
+	int32 FirstJoint = 0;
+	int32 NumJoints = 0;
+};
+
+struct FIKFingerRange : public FIKJointRange
+{
+	EIKFinger Finger = EIKFinger::Index;
+};
+
+struct FIKHandRange : public FIKJointRange
+{
+	int32 FirstFinger = 0;
+	int32 NumFingers = 0;
+};
+
+/** Compact index tables the IKBody component runs finger IK on, built once from a skeleton profile */
+struct UNREALBODY_API FIKFingerJointTables
+{
+	/** Indexed by ECharacterIKHand */
+	FIKHandRange Hands[2];
+
+	TArray<FIKFingerRange> Fingers;
+	TArray<FIKFingerJointInfo> Joints;
+
+	void Build(const TArray<FIKHandDefinition>& HandDefinitions);
+
+	/** Finds the joint index of a bone, or INDEX_NONE */
+	int32 FindJoint(FName Bone) const;
+};
+
+/**
+ * Declares the hands, fingers and joints of a body.
+ * Hands with more or fewer tracked joints than the mannequin only pay for the joints they declare.
+ */
+UCLASS(BlueprintType)
+class UNREALBODY_API UIKBodySkeletonProfile : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Hands")
+		TArray<FIKHandDefinition> Hands;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Hitboxes")
+		FName HitboxCollisionProfileName = TEXT("OverlapAllDynamic");
+
+	/** The layout of the UE4 mannequin (15 joints per hand), used when no profile is assigned. Hitboxes are not pooled. */
+	static void GetMannequinHands(TArray<FIKHandDefinition>& OutHands);
+};
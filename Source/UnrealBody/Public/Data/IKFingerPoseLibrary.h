@@ -0,0 +1,97 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Curves/CurveFloat.h"
+#include "Library/AnimationStructLibrary.h"
+
+#include "IKFingerPoseLibrary.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIKFingerPoseLibrary, Log, All);
+
+/** Curl curves for the three joints of a finger, mapping a finger curl [0, 1] to a per-bone blend alpha [0, 1] */
+USTRUCT(BlueprintType)
+struct FIKFingerCurlCurves
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		FRuntimeFloatCurve Proximal;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		FRuntimeFloatCurve Intermediate;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		FRuntimeFloatCurve Distal;
+};
+
+/**
+ * Baked finger pose library.
+ * The authored curl curves are sampled into a quantized lookup table when the asset is saved (and cooked), 
+ * so evaluating the three bones of a finger at runtime is a table lookup instead of three curve evaluations.
+ * The table is shared between hands, the left and right fingers use the same curves.
+ */
+UCLASS(BlueprintType)
+class UNREALBODY_API UIKFingerPoseLibrary : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Number of joints per finger, matching EFingerBone (_01, _02, _03) */
+	static constexpr int32 JointsPerFinger = 3;
+
+	/** Number of fingers per hand, matching EIKFinger */
+	static constexpr int32 FingersPerHand = 5;
+
+	UPROPERTY(EditAnywhere, Category = "Curves")
+		FIKFingerCurlCurves Index;
+
+	UPROPERTY(EditAnywhere, Category = "Curves")
+		FIKFingerCurlCurves Middle;
+
+	UPROPERTY(EditAnywhere, Category = "Curves")
+		FIKFingerCurlCurves Ring;
+
+	UPROPERTY(EditAnywhere, Category = "Curves")
+		FIKFingerCurlCurves Pinky;
+
+	UPROPERTY(EditAnywhere, Category = "Curves")
+		FIKFingerCurlCurves Thumb;
+
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "2", ClampMax = "256"))
+		int32 SampleCount = 32
+		UMETA(Tooltip = "Amount of samples taken from each curve between a curl of 0 and 1. Higher values cost more memory but reduce interpolation error.");
+
+	/** Evaluates the alphas of a finger's three joints for the given curl using the baked table */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Fingers")
+		void SampleFinger(EIKFinger Finger, float Curl, float& Proximal, float& Intermediate, float& Distal) const;
+
+	/** Size of the baked lookup table in bytes */
+	UFUNCTION(BlueprintPure, Category = "IKBody | Fingers")
+		int32 GetBakedSize() const { return this->BakedTable.Num() * this->BakedTable.GetTypeSize(); }
+
+	/** Resamples all curves into the lookup table */
+	void Bake();
+
+	virtual void PostLoad() override;
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	/** Quantized alphas laid out as [Finger][Sample][Joint] */
+	UPROPERTY()
+		TArray<uint8> BakedTable;
+
+	const FIKFingerCurlCurves& GetCurves(EIKFinger Finger) const;
+};
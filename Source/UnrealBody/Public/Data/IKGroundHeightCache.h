@@ -0,0 +1,91 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+
+#include "IKGroundHeightCache.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIKGroundHeightCache, Log, All);
+
+/** Square block of baked ground cells. Tiles without any ground are left empty. */
+USTRUCT()
+struct FIKGroundTile
+{
+	GENERATED_BODY()
+
+	/** Ground height per cell, NoGround where nothing was hit */
+	UPROPERTY()
+		TArray<float> Heights;
+
+	/** Ground normal per cell, X and Y quantized to a byte each (Z is always up) */
+	UPROPERTY()
+		TArray<uint16> Normals;
+};
+
+/**
+ * Ground heights and normals baked from static level collision on a tiled grid.
+ * Foot IK samples it with a bilinear lookup instead of tracing the physics scene.
+ * Only stores one ground layer: the highest static surface in every cell. Foot IK traces live where that isn't the floor the foot is on.
+ * The bake traces WorldStatic objects while live foot traces use the Visibility channel, so static collision that ignores
+ * Visibility is baked as ground, and non-WorldStatic ground that blocks Visibility is missing from the cache. Tag such actors IKGround.
+ */
+UCLASS(BlueprintType)
+class UNREALBODY_API UIKGroundHeightCache : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Cells per tile side */
+	static constexpr int32 TileCells = 32;
+
+	/** Height of cells without ground */
+	static constexpr float NoGround = -MAX_flt;
+
+	/** Actors with this tag are left out of the bake and traced live instead */
+	static const FName DynamicGroundTag;
+
+	UPROPERTY(EditAnywhere, Category = "Baking", meta = (ClampMin = "1"))
+		float CellSize = 10.0f
+		UMETA(Tooltip = "Size of a grid cell in units. Smaller cells follow the ground more closely but cost more memory.");
+
+	/** Traces static collision within the bounds into the grid */
+	void Bake(UWorld* World, const FBox& Bounds);
+
+	/** Bilinear ground height and normal at a location. Returns false outside the grid or next to a cell without ground */
+	bool Sample(const FVector& Location, float& OutHeight, FVector& OutNormal) const;
+
+	bool IsBaked() const { return this->Tiles.Num() > 0; }
+
+	/** Size of the baked grid in bytes */
+	UFUNCTION(BlueprintPure, Category = "IKBody | Ground")
+		int32 GetBakedSize() const;
+
+private:
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+		FVector2D Origin = FVector2D::ZeroVector;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+		int32 NumCellsX = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+		int32 NumCellsY = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+		float BakedCellSize = 0.0f;
+
+	UPROPERTY()
+		TArray<FIKGroundTile> Tiles;
+
+	int32 GetNumTilesX() const { return FMath::DivideAndRoundUp(this->NumCellsX, TileCells); }
+
+	// Returns false for cells outside the grid or without ground
+	bool GetCell(int32 X, int32 Y, float& OutHeight, FVector& OutNormal) const;
+};
@@ -0,0 +1,58 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+
+#include "IKBodyInputSource.generated.h"
+
+class UIKBodyComponent;
+
+/** World transforms of the three tracked points that drive a body */
+USTRUCT(BlueprintType)
+struct FIKTrackedPoses
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FTransform Head = FTransform::Identity;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FTransform LeftHand = FTransform::Identity;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FTransform RightHand = FTransform::Identity;
+
+	/** Untracked hands keep their transform but aren't used to prepare grips */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool bLeftHandTracked = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool bRightHandTracked = false;
+};
+
+UINTERFACE(MinimalAPI, BlueprintType, meta = (CannotImplementInterfaceInBlueprint))
+class UIKBodyInputSource : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Source of the head and hand poses of the IKBody component, used instead of its camera and controllers.
+ * Sampled at most once per frame per body, before the body is solved.
+ */
+class UNREALBODY_API IIKBodyInputSource
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the poses of a body this frame, or false to keep the last ones */
+	virtual bool SamplePoses(const UIKBodyComponent* Body, FIKTrackedPoses& OutPoses) = 0;
+};
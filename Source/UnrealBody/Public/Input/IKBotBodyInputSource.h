@@ -0,0 +1,105 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Input/IKBodyInputSource.h"
+
+#include "IKBotBodyInputSource.generated.h"
+
+class UNavigationPath;
+
+/**
+ * Procedural head and hand motion for bots and load tests, so a body runs its full pipeline without a VR player.
+ * Walks along a path with a head bob and swinging hands, looking at a gaze target or idly around.
+ * Only moves the body, the owning actor stays where it is. One driver per body, it keeps the bot's walking state.
+ */
+UCLASS(BlueprintType)
+class UNREALBODY_API UIKBotBodyInputSource : public UObject, public IIKBodyInputSource
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float WalkSpeed = 120.0f
+		UMETA(Tooltip = "Speed along the path in units per second.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float EyeHeight = 165.0f
+		UMETA(Tooltip = "Height of the head above the path.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float StrideLength = 70.0f
+		UMETA(Tooltip = "Distance of a single step, the head bobs and the hands swing once per step.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float HeadBob = 2.5f
+		UMETA(Tooltip = "Height the head bobs while walking.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float HandSwing = 12.0f
+		UMETA(Tooltip = "Distance the hands swing forward and back while walking.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float TurnRate = 180.0f
+		UMETA(Tooltip = "Maximum degrees per second the head and walking direction turn.");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bot")
+		float MaxHeadYaw = 70.0f
+		UMETA(Tooltip = "Maximum degrees the head turns away from the walking direction towards the gaze target.");
+
+	/** Walks along the points from the first one. The bot starts at the body when it had no path yet. */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Bot")
+		void SetPath(const TArray<FVector>& Points);
+
+	/** Walks along a navigation path from the bot's current location */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Bot")
+		void SetNavPath(UNavigationPath* Path);
+
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Bot")
+		void SetGazeTarget(FVector Location);
+
+	/** Follows an actor with the head, overrides a gaze target location */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Bot")
+		void SetGazeActor(AActor* Actor);
+
+	/** Returns to looking around idly */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Bot")
+		void ClearGaze();
+
+	UFUNCTION(BlueprintPure, Category = "IKBody | Bot")
+		bool IsPathComplete() const { return this->PathPoint >= this->Path.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "IKBody | Bot")
+		FVector GetBotLocation() const { return this->Location; }
+
+	// IIKBodyInputSource
+	virtual bool SamplePoses(const UIKBodyComponent* Body, FIKTrackedPoses& OutPoses) override;
+
+private:
+	TArray<FVector> Path;
+	int32 PathPoint = 0;
+
+	TWeakObjectPtr<AActor> GazeActor;
+	FVector GazeLocation = FVector::ZeroVector;
+	bool bHasGaze = false;
+
+	// Location on the path, the bot's feet
+	FVector Location = FVector::ZeroVector;
+	float WalkYaw = 0.0f;
+	float HeadYaw = 0.0f;
+	float HeadPitch = 0.0f;
+	float StridePhase = 0.0f;
+
+	// Offsets the idle motion so bots don't move in lockstep
+	float IdlePhase = 0.0f;
+	double LastSampleTime = 0.0;
+	bool bStarted = false;
+};
@@ -0,0 +1,53 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Library/CharacterStateLibrary.h"
+
+#include "IKHandInputSource.generated.h"
+
+/** Finger input of one hand at a single point in time */
+USTRUCT(BlueprintType)
+struct FIKHandInputFrame
+{
+	GENERATED_BODY()
+
+	/** Curl [0, 1] per finger, in EIKFinger order */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		TArray<float> FingerCurls;
+
+	/** Local rotation per joint, in the order the skeleton profile declares the joints of this hand. Used instead of the curls when set. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		TArray<FQuat> JointRotations;
+
+	/** FPlatformTime::Seconds() when the input was produced (or read, for devices without timestamps), used to measure input to pose latency */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		double SampleTime = 0.0;
+};
+
+UINTERFACE(MinimalAPI, BlueprintType, meta = (CannotImplementInterfaceInBlueprint))
+class UIKHandInputSource : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Source of finger input for the IKBody component, sampled right before the body's animation is updated.
+ * Hands with input bypass the collision driven finger IK.
+ */
+class UNREALBODY_API IIKHandInputSource
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the newest input of a hand, or false if the hand isn't tracked */
+	virtual bool SampleHand(ECharacterIKHand Hand, FIKHandInputFrame& OutFrame) = 0;
+};
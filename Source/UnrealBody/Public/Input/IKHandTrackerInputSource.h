@@ -0,0 +1,33 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Input/IKHandInputSource.h"
+
+#include "IKHandTrackerInputSource.generated.h"
+
+/**
+ * Hand input read from the active IHandTracker (OpenXR hand tracking and similar).
+ * Finger curls are derived from the angle between the base and the tip of each finger.
+ */
+UCLASS(BlueprintType)
+class UNREALBODY_API UIKHandTrackerInputSource : public UObject, public IIKHandInputSource
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Hand Tracking")
+		float FullCurlAngle = 160.0f
+		UMETA(Tooltip = "Angle in degrees between the finger base and tip that is considered a fully curled finger.");
+
+	// IIKHandInputSource
+	virtual bool SampleHand(ECharacterIKHand Hand, FIKHandInputFrame& OutFrame) override;
+};
@@ -0,0 +1,45 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Input/IKHandInputSource.h"
+
+#include "IKMockHandInputSource.generated.h"
+
+/**
+ * Hand input that is set manually, for testing hand input without a tracking device.
+ * Each update is stamped with the time it was set, so input to pose latency can be measured.
+ */
+UCLASS(BlueprintType)
+class UNREALBODY_API UIKMockHandInputSource : public UObject, public IIKHandInputSource
+{
+	GENERATED_BODY()
+
+public:
+	/** Sets the curl of every finger of a hand, in EIKFinger order */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Input")
+		void SetFingerCurls(ECharacterIKHand Hand, const TArray<float>& Curls);
+
+	/** Sets the rotation of every joint of a hand, in skeleton profile order */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Input")
+		void SetJointRotations(ECharacterIKHand Hand, const TArray<FQuat>& Rotations);
+
+	/** Stops providing input for a hand, returning it to collision driven finger IK */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Input")
+		void ClearHand(ECharacterIKHand Hand);
+
+	// IIKHandInputSource
+	virtual bool SampleHand(ECharacterIKHand Hand, FIKHandInputFrame& OutFrame) override;
+
+private:
+	FIKHandInputFrame Frames[2];
+	bool HasInput[2] = { false, false };
+};
@@ -105,6 +105,17 @@ enum class EFingerBone : uint8
 	thumb_03_r
 };
 
+/** Fingers of a single hand, in the same order as they appear in EFingerBone */
+UENUM(BlueprintType)
+enum class EIKFinger : uint8
+{
+	Index,
+	Middle,
+	Ring,
+	Pinky,
+	Thumb
+};
+
 /** Anim Graph - Finger IK */
 USTRUCT(BlueprintType)
 struct FAnimGraphFingerIK
@@ -150,7 +161,7 @@ struct FAnimGraphFingerIK
 	}
 };
 
-/** Anim Graph - Finger IK */
+/** Deprecated, the IKBody component keeps finger states in its joint tables. Kept so Blueprints and assets that reference it still load. */
 USTRUCT(BlueprintType)
 struct FFingerStateMap
 {
@@ -24,4 +24,14 @@ enum class ECharacterIKHand : uint8
 {
 	Left,
 	Right
-};
\ No newline at end of file
+};
+
+/** IK quality levels the frame time governor steps through, each level includes the reductions of the ones before it */
+UENUM(BlueprintType)
+enum class EIKBodyQualityLevel : uint8
+{
+	Full,
+	ReducedFingerContacts,
+	ReducedFootTraces,
+	ReducedBodyTick
+};
@@ -0,0 +1,126 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Async/MappedFileHandle.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIKPoseStream, Log, All);
+
+/** Everything needed to pose an IK body without its camera and controllers */
+struct UNREALBODY_API FIKPoseFrame
+{
+	FTransform Root = FTransform::Identity;
+	FTransform Head = FTransform::Identity;
+	FTransform LeftHand = FTransform::Identity;
+	FTransform RightHand = FTransform::Identity;
+	float MovementSpeed = 0.0f;
+	float MovementDirection = 0.0f;
+	TArray<float> JointAlphas;
+
+	/** Blends two frames, used to play back between recorded frames */
+	static void Blend(const FIKPoseFrame& A, const FIKPoseFrame& B, float Alpha, FIKPoseFrame& Out);
+};
+
+/**
+ * Layout of a pose stream file.
+ * Frames are recorded at a fixed rate into fixed-size chunks, so the chunk holding any time is found with a multiplication.
+ * Each chunk starts with a keyframe, later frames store positions as deltas to the previous frame.
+ *
+ * Header | Chunk 0 | Chunk 1 | ...
+ * Chunk: int32 NumFrames | Keyframe | Delta frame * (FramesPerChunk - 1)
+ * Keyframe: double positions * 4 | rotations | movement | joint alphas
+ * Delta frame: int16 position deltas * 4 | rotations | movement | joint alphas
+ */
+struct UNREALBODY_API FIKPoseStreamFormat
+{
+	static constexpr uint32 Magic = 0x53504B49; // IKPS
+	static constexpr uint32 Version = 1;
+	static constexpr int32 HeaderSize = 24;
+
+	/** Number of recorded transforms: root, head, left and right hand */
+	static constexpr int32 NumTransforms = 4;
+
+	/** Position delta resolution in units */
+	static constexpr float PositionStep = 0.1f;
+
+	float FrameRate = 30.0f;
+	int32 FramesPerChunk = 30;
+	int32 NumJoints = 0;
+	int32 NumFrames = 0;
+
+	int32 GetKeyframeSize() const { return NumTransforms * (3 * sizeof(double) + 3 * sizeof(int16)) + 2 * sizeof(int16) + NumJoints; }
+	int32 GetDeltaFrameSize() const { return NumTransforms * (3 * sizeof(int16) + 3 * sizeof(int16)) + 2 * sizeof(int16) + NumJoints; }
+	int32 GetChunkSize() const { return sizeof(int32) + this->GetKeyframeSize() + (this->FramesPerChunk - 1) * this->GetDeltaFrameSize(); }
+};
+
+/** Records the poses of an IK body into a pose stream file */
+class UNREALBODY_API FIKPoseStreamWriter
+{
+public:
+	~FIKPoseStreamWriter() { this->Close(); }
+
+	bool Open(const FString& Filename, int32 NumJoints, float FrameRate, int32 FramesPerChunk);
+
+	/** Appends a frame, frames are expected at the stream's frame rate */
+	void AddFrame(const FIKPoseFrame& Frame);
+
+	/** Writes the last (partial) chunk and the final header */
+	void Close();
+
+	bool IsOpen() const { return this->File.IsValid(); }
+	const FIKPoseStreamFormat& GetFormat() const { return this->Format; }
+	SIZE_T GetAllocatedSize() const { return sizeof(*this) + this->Filename.GetAllocatedSize() + this->Chunk.GetAllocatedSize(); }
+
+private:
+	TUniquePtr<IFileHandle> File;
+	FString Filename;
+	FIKPoseStreamFormat Format;
+	TArray<uint8> Chunk;
+	int32 ChunkFrames = 0;
+	double EncodeSeconds = 0.0;
+
+	// Positions as the reader will decode them, so quantization error doesn't accumulate over a chunk
+	FVector Decoded[FIKPoseStreamFormat::NumTransforms];
+
+	void WriteHeader();
+	void FlushChunk();
+};
+
+/** Plays back a pose stream file, memory mapped so seeking doesn't read anything but the chunk it lands in */
+class UNREALBODY_API FIKPoseStreamReader
+{
+public:
+	bool Open(const FString& Filename);
+	void Close();
+
+	bool IsOpen() const { return this->Data != nullptr; }
+	const FIKPoseStreamFormat& GetFormat() const { return this->Format; }
+	float GetDuration() const { return this->Format.NumFrames / this->Format.FrameRate; }
+
+	/** Heap memory only, the mapped file is paged in by the OS */
+	SIZE_T GetAllocatedSize() const { return sizeof(*this) + this->NextFrame.JointAlphas.GetAllocatedSize(); }
+
+	/** Decodes a single frame: its chunk's keyframe plus at most FramesPerChunk - 1 deltas */
+	bool ReadFrame(int32 Frame, FIKPoseFrame& Out) const;
+
+	/** Pose at a time in seconds from the start of the stream, blended between the nearest frames */
+	bool Sample(float Time, FIKPoseFrame& Out) const;
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+	FIKPoseStreamFormat Format;
+
+	// Scratch frame for blending
+	mutable FIKPoseFrame NextFrame;
+};
@@ -0,0 +1,72 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Result flags of the batched body solve */
+namespace EIKBodySolveFlags
+{
+	enum Type : int32
+	{
+		None = 0,
+		Moved = 1 << 0,		// The head moved further than the movement threshold, the body should step
+		Rotated = 1 << 1	// The head turned further than the rotation threshold, the body should turn
+	};
+}
+
+/**
+ * Packed (structure of arrays) input and output of the 3-point body solve for N bodies.
+ * Solved in a single pass, with ISPC when available and a scalar fallback otherwise.
+ */
+struct UNREALBODY_API FIKBodySolveBatch
+{
+	// Input: current camera location and forward vector
+	TArray<float> CameraX, CameraY, CameraZ;
+	TArray<float> ForwardX, ForwardY, ForwardZ;
+	TArray<float> CameraYaw;
+
+	// Input: camera location, forward vector and yaw the body last stepped to
+	TArray<float> LastX, LastY;
+	TArray<float> LastForwardX, LastForwardY, LastForwardZ;
+	TArray<float> LastYaw;
+
+	// Input: per body settings
+	TArray<float> BodyOffset;
+	TArray<float> MovementThreshold;
+	TArray<float> RotationThreshold;
+
+	// Output: body (and head) target location, XY distance moved, signed movement direction and yaw difference in degrees
+	TArray<float> TargetX, TargetY, TargetZ;
+	TArray<float> Distance;
+	TArray<float> Direction;
+	TArray<float> YawDifference;
+	TArray<int32> Flags;
+
+	int32 Num() const { return this->CameraX.Num(); }
+
+	/** Resizes all arrays to hold the given amount of bodies */
+	void SetNum(int32 NumBodies);
+
+	/** Solves every body in the batch */
+	void Solve();
+
+	/** Solves a range of bodies with the scalar implementation */
+	void SolveScalar(int32 Begin, int32 End);
+
+	/**
+	 * Solves a fixed set of regular and edge case bodies with ISPC and the scalar implementation and compares every output bit for bit.
+	 * Returns the number of bodies that differ, 0 when ISPC isn't available. Solve falls back to the scalar implementation if this fails.
+	 */
+	static int32 TestDeterminism();
+
+private:
+	/** Solves every body with the ISPC kernel */
+	void SolveISPC();
+};
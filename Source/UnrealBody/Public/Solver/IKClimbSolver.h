@@ -0,0 +1,48 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** World space input of the climbing body solve */
+struct FIKClimbSolveInput
+{
+	FVector Head = FVector::ZeroVector;
+
+	/** Gripped hand locations, indexed by ECharacterIKHand */
+	FVector Anchors[2] = { FVector::ZeroVector, FVector::ZeroVector };
+	bool bAnchored[2] = { false, false };
+
+	float PlayerHeight = 0.0f;
+	float BodyOffset = 0.0f;
+	float ArmLength = 0.0f;
+	float ShoulderWidth = 0.0f;
+};
+
+/**
+ * Hangs a body from its gripped hands, below the head as far as the arms reach.
+ * Incremental: every solve starts from the previous solution and stops once it moves less than the tolerance,
+ * and a climber whose head and hands didn't move isn't iterated at all.
+ */
+struct UNREALBODY_API FIKClimbSolver
+{
+	/** Body root and facing yaw, towards the grips */
+	FVector Root = FVector::ZeroVector;
+	float Yaw = 0.0f;
+
+	/** Starts from a known body placement, e.g. where the body stood when it started climbing */
+	void Reset(const FVector& InRoot, float InYaw);
+
+	/** Returns the number of iterations it took, 0 if the previous solution still holds */
+	int32 Solve(const FIKClimbSolveInput& Input);
+
+private:
+	FIKClimbSolveInput LastInput;
+	bool bConverged = false;
+};
@@ -0,0 +1,45 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Library/CharacterStateLibrary.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIKBodyGovernor, Log, All);
+
+/**
+ * Measures the frame's work time against a target (IKBody.Governor.TargetMs) and steps the IK quality of all bodies down while over it:
+ * first finger contact polling, then foot traces, then the body tick rate. Quality steps back up once the work time
+ * has stayed well under the target for a while. Off by default (IKBody.Governor).
+ */
+class UNREALBODY_API FIKBodyQualityGovernor
+{
+public:
+	static FIKBodyQualityGovernor& Get();
+
+	/** Updates the level from the last frame's work time, only the first call in a frame counts. The world tick time is used where there are no thread times. */
+	void Tick(float WorldTickMs);
+
+	EIKBodyQualityLevel GetLevel() const { return this->ForcedLevel != INDEX_NONE ? (EIKBodyQualityLevel) this->ForcedLevel : this->Level; }
+
+	/** Pins the level, INDEX_NONE hands control back to the governor */
+	void SetForcedLevel(int32 InLevel);
+
+	float GetSmoothedFrameMs() const { return this->SmoothedFrameMs; }
+
+private:
+	EIKBodyQualityLevel Level = EIKBodyQualityLevel::Full;
+	int32 ForcedLevel = INDEX_NONE;
+	float SmoothedFrameMs = 0.0f;
+	int32 OverBudgetFrames = 0;
+	int32 UnderBudgetFrames = 0;
+	uint64 LastTickFrame = MAX_uint64;
+
+	void SetLevel(EIKBodyQualityLevel NewLevel);
+};
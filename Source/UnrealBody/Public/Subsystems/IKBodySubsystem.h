@@ -0,0 +1,146 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Solver/IKBodyBatchSolver.h"
+#include "Data/IKGroundHeightCache.h"
+#include "Subsystems/IKGripRegistry.h"
+
+#include "IKBodySubsystem.generated.h"
+
+class UIKBodyComponent;
+class UIKMockHandInputSource;
+class UIKBodySubsystem;
+
+/** Solves the movement of every body in one batch, after the pawns they follow have ticked and before the bodies tick */
+USTRUCT()
+struct FIKBodySolveTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UIKBodySubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("FIKBodySolveTickFunction"); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FIKBodySolveTickFunction> : public TStructOpsTypeTraitsBase2<FIKBodySolveTickFunction>
+{
+	enum { WithCopy = false };
+};
+
+/**
+ * Keeps track of all IK bodies in a world, so per-body work can be done for all of them at once.
+ */
+UCLASS()
+class UNREALBODY_API UIKBodySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	void RegisterBody(UIKBodyComponent* Body);
+	void UnregisterBody(UIKBodyComponent* Body);
+
+	const TArray<UIKBodyComponent*>& GetBodies() const { return this->Bodies; }
+
+	/** Solves the movement of every registered body in one batch, run by the solve tick function once per frame */
+	void SolveBodies();
+
+	const FIKBodySolveBatch& GetSolveBatch() const { return this->SolveBatch; }
+
+	/** Ground height cache foot IK samples instead of tracing, set by the level's cache volume */
+	void SetGroundHeightCache(UIKGroundHeightCache* Cache) { this->GroundHeightCache = Cache; }
+	UIKGroundHeightCache* GetGroundHeightCache() const { return this->GroundHeightCache; }
+
+	/**
+	 * Ground height and normal below a location from the ground height cache.
+	 * Returns false if there is no cache, the location is outside of it, or above dynamic IK ground; these need a live trace.
+	 */
+	bool SampleCachedGround(const FVector& Location, float& OutHeight, FVector& OutNormal) const;
+
+	/** Adds the collision of an actor as dynamic ground, which is always traced live */
+	void RegisterDynamicGround(AActor* Actor);
+
+	/** Adds an actor to the grip registry, so bodies can prepare their grip while a hand approaches it. Actors tagged IKGrippable are added automatically. */
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Grip")
+		void RegisterGrippable(AActor* Actor);
+
+	UFUNCTION(BlueprintCallable, Category = "IKBody | Grip")
+		void UnregisterGrippable(AActor* Actor);
+
+	const FIKGripRegistry& GetGripRegistry() const { return this->GripRegistry; }
+
+	/** Drives the fingers of every body from a mock hand input source for a number of frames, then logs the input to pose latency */
+	void StartHandInputBenchmark(int32 Frames);
+
+	/** Ticks every body and its animation headless and with the full cosmetic IK, and logs the cost per player of both */
+	void BenchmarkServerTick(int32 Ticks);
+
+private:
+	UPROPERTY(Transient)
+		UIKGroundHeightCache* GroundHeightCache = nullptr;
+
+	FIKGripRegistry GripRegistry;
+	void OnGrippableMoved(USceneComponent* Root, EUpdateTransformFlags Flags, ETeleportType Teleport);
+
+	UFUNCTION()
+		void OnGrippableEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> DynamicGround;
+	void OnActorSpawned(AActor* Actor);
+	FDelegateHandle ActorSpawnedHandle;
+
+	// Registers and unregisters the IK ground and grippables of levels streamed in and out
+	void OnLevelAddedToWorld(ULevel* Level, UWorld* World);
+	void OnLevelRemovedFromWorld(ULevel* Level, UWorld* World);
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+
+	// Applies the late update of every body once all actors and animation have ticked
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	FDelegateHandle PostActorTickHandle;
+
+	// Times the world's actor tick for the quality governor, and sets new hand input at the start of every frame while benchmarking
+	void OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	double ActorTickStartTime = 0.0;
+
+	// Hand input benchmark, input is measured once the poses are evaluated
+	void FinishHandInputBenchmark();
+	FDelegateHandle PreActorTickHandle;
+
+	UPROPERTY(Transient)
+		UIKMockHandInputSource* BenchmarkInput = nullptr;
+
+	TArray<TPair<TWeakObjectPtr<UIKBodyComponent>, TWeakObjectPtr<UObject>>> BenchmarkBodies;
+	int32 BenchmarkFramesLeft = 0;
+	int32 BenchmarkSamples = 0;
+	double BenchmarkLatencySum = 0.0;
+	float BenchmarkLatencyMax = 0.0f;
+
+	// Distant bodies in the same movement state share the pose of one leader, keyed by mesh, anim class and quantized movement
+	typedef TTuple<const USkeletalMesh*, const UClass*, uint16> FPoseSharingKey;
+	bool GetPoseSharingKey(UIKBodyComponent* Body, TArrayView<const FVector> Views, FPoseSharingKey& OutKey) const;
+	void UpdatePoseSharing(float DeltaSeconds);
+	float PoseSharingPendingTime = 0.0f;
+
+	UPROPERTY(Transient)
+		TArray<UIKBodyComponent*> Bodies;
+
+	FIKBodySolveBatch SolveBatch;
+	FIKBodySolveTickFunction SolveTickFunction;
+};
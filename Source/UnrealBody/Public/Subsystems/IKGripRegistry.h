@@ -0,0 +1,60 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+/**
+ * Spatial hash of grippable actors, keyed by the cells their collision bounds overlap.
+ * Moving actors rehash themselves when their root moves, so a query only touches the cells around it.
+ * Actors spanning more than MaxCellsPerActor cells are kept in a short list every query checks instead.
+ */
+struct UNREALBODY_API FIKGripRegistry
+{
+	/** Actors with this tag are registered automatically */
+	static const FName GrippableTag;
+
+	/** Cell size in units, queries with a radius up to this size visit 27 cells */
+	static constexpr float CellSize = 50.0f;
+
+	static constexpr int32 MaxCellsPerActor = 64;
+
+	void Add(AActor* Actor);
+	void Remove(AActor* Actor);
+
+	/** Moves an actor to the cells of its current bounds */
+	void Update(AActor* Actor);
+
+	/** Registered actor with the nearest collision bounds within the radius of a location */
+	AActor* FindNearest(const FVector& Location, float Radius) const;
+
+	bool Contains(AActor* Actor) const { return this->Entries.Contains(Actor); }
+
+	int32 Num() const { return this->Entries.Num(); }
+
+private:
+	struct FEntry
+	{
+		FBox Bounds = FBox(ForceInit);
+		FIntVector MinCell = FIntVector::ZeroValue;
+		FIntVector MaxCell = FIntVector::ZeroValue;
+		bool bLarge = false;
+	};
+
+	TMap<FIntVector, TArray<TWeakObjectPtr<AActor>>> Cells;
+	TMap<TWeakObjectPtr<AActor>, FEntry> Entries;
+	TArray<TWeakObjectPtr<AActor>> LargeActors;
+
+	void Link(AActor* Actor, FEntry& Entry);
+	void Unlink(AActor* Actor, const FEntry& Entry);
+
+	static FBox GetBounds(const AActor* Actor);
+	static FIntVector GetCell(const FVector& Location);
+};
@@ -3,6 +3,9 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("IKBody"), STATGROUP_IKBody, STATCAT_Advanced);
 
 class FUnrealBodyModule : public IModuleInterface
 {
@@ -47,7 +47,11 @@ public class UnrealBody : ModuleRules
                 "Sockets",
                 "Networking",
                 "Engine",
-                "InputCore"
+                "InputCore",
+                "AnimGraphRuntime",
+                "AnimationCore",
+                "HeadMountedDisplay",
+                "AnimationBudgetAllocator"
 			}
 		);
 
@@ -69,7 +73,10 @@ public class UnrealBody : ModuleRules
 				"CoreUObject",
 				"Engine",
 				"Slate",
-				"SlateCore"
+				"SlateCore",
+				"NavigationSystem",
+				"RenderCore",
+				"RHI"
 			}
 		);
 		
@@ -0,0 +1,29 @@
+/*
+*   Copyright 2022 Kaz Voeten
+*
+*	Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*	The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "AnimGraphNode_IKFootPlacement.h"
+
+#define LOCTEXT_NAMESPACE "UnrealBodyEditor"
+
+FText UAnimGraphNode_IKFootPlacement::GetControllerDescription() const
+{
+	return LOCTEXT("IKFootPlacement", "IK Foot Placement");
+}
+
+FText UAnimGraphNode_IKFootPlacement::GetTooltipText() const
+{
+	return LOCTEXT("IKFootPlacement_Tooltip", "Places both feet on the ground using heel and toe samples, lowers the pelvis to reach it and locks planted feet. Replaces the per-foot traces of the IK body anim instance.");
+}
+
+FText UAnimGraphNode_IKFootPlacement::GetNodeTitle(ENodeTitleType::Type TitleType) const
+{
+	return GetControllerDescription();
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,18 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "UnrealBodyEditor.h"
+
+#define LOCTEXT_NAMESPACE "FUnrealBodyEditorModule"
+
+void FUnrealBodyEditorModule::StartupModule()
+{
+	// Anim graph nodes are registered through reflection, nothing to do here yet
+}
+
+void FUnrealBodyEditorModule::ShutdownModule()
+{
+}
+
+#undef LOCTEXT_NAMESPACE
+	
+IMPLEMENT_MODULE(FUnrealBodyEditorModule, UnrealBodyEditor)